@@ -22,6 +22,7 @@ SOFTWARE.
 
 #include "Client.h"
 #include "ospcommon/networking/Socket.h"
+#include <algorithm>
 
 namespace ospray {
   namespace dw {
@@ -51,10 +52,34 @@ namespace ospray {
     
     Client::Client(const MPI::Group &me,
                    const std::string &portName)
-      : me(me), wallConfig(NULL)
+      : me(me), wallConfig(NULL),
+        frameWindow(NULL),
+        frameExchange(NULL),
+        codec(TileCodec::defaultType()),
+        numStridedTiles(0),
+        adaptiveCodec(false),
+        quality(100),
+        rateController(NULL),
+        frameQuality(100),
+        frameSubsampling(CHROMA_444),
+        bytesSentThisFrame(0),
+        tileHistory(NULL),
+        skipUnchanged(false),
+        deltaEncoding(false),
+        keyFrameInterval(0),
+        keyFrameRequested(false),
+        keyFrame(true),
+        frameID(0),
+        maxFramesInFlight(1),
+        serverFramesInFlight(1),
+        sendEngine(NULL),
+        batcher(NULL)
     {
       establishConnection(portName);
       receiveDisplayConfig();
+      clientGroup = me.dup();
+      sendEngine = new SendEngine(displayGroup);
+      batcher = new TileBatcher(displayGroup,256*1024,.002,sendEngine);
 
       assert(wallConfig);
       if (me.rank == 0)
@@ -75,10 +100,39 @@ namespace ospray {
       MPI_CALL(Bcast(&relativeBezelWidth,2,MPI_FLOAT,0,displayGroup.comm));
       MPI_CALL(Bcast(&arrangement,1,MPI_INT,0,displayGroup.comm));
       MPI_CALL(Bcast(&stereo,1,MPI_INT,0,displayGroup.comm));
+      MPI_CALL(Bcast(&serverFramesInFlight,1,MPI_INT,0,displayGroup.comm));
+      int numHeadNodes;
+      MPI_CALL(Bcast(&numHeadNodes,1,MPI_INT,0,displayGroup.comm));
+      headNodeRegions.resize(numHeadNodes);
+      MPI_CALL(Bcast(headNodeRegions.data(),4*numHeadNodes,MPI_INT,0,displayGroup.comm));
+      int numWindowSlots;
+      MPI_CALL(Bcast(&numWindowSlots,1,MPI_INT,0,displayGroup.comm));
+      int sharedMemory;
+      MPI_CALL(Bcast(&sharedMemory,1,MPI_INT,0,displayGroup.comm));
+      int exchange;
+      MPI_CALL(Bcast(&exchange,1,MPI_INT,0,displayGroup.comm));
       wallConfig = new WallConfig(numDisplays,pixelsPerDisplay,
                                   relativeBezelWidth,
                                   (WallConfig::DisplayArrangement)arrangement,
                                   stereo);
+      if (numWindowSlots > 0) {
+        if (me.rank == 0)
+          cout << "#osp.dw: display wall wants raw pixels put into its frame buffers" << endl;
+        frameWindow = new FrameWindow(displayGroup,false,*wallConfig,numWindowSlots);
+      }
+      if (sharedMemory) {
+        localRings = ShmTileRing::connect(displayGroup,false);
+        const int numLocal
+          = localRings.size() - std::count(localRings.begin(),localRings.end(),nullptr);
+        if (numLocal > 0)
+          cout << "#osp.dw: client " << me.rank << " sends tiles to " << numLocal
+               << " display(s) on its node through shared memory" << endl;
+      }
+      if (exchange) {
+        if (me.rank == 0)
+          cout << "#osp.dw: display wall wants each frame's tiles in one collective exchange" << endl;
+        frameExchange = new FrameExchange(displayGroup);
+      }
     }
 
     /*! establish connection between 'me' and the remote service */
@@ -108,35 +162,286 @@ namespace ospray {
     {
       DW_DBG(printf("#osp.dw(dsp): client %i/%i barriering on %i/%i\n",me.rank,me.size,
                  displayGroup.rank,displayGroup.size));
-      MPI_CALL(Barrier(displayGroup.comm));
+      /* all tiles of this frame have to be on their way before the
+         barrier (the displays only enter it once they have all
+         pixels); they don't have to have been received yet, though.
+         Puts, however, have to have arrived, since that's all the
+         displays have to go by */
+      batcher->flush();
+      sendEngine->postAll();
+      if (frameWindow)
+        frameWindow->flush();
+      if (frameExchange)
+        frameExchange->post();
+      /* there's one barrier per frame, which the displays enter once
+         they have completed that frame; we only enter it here, and
+         don't wait for it until we'd otherwise have more frames in
+         flight (counting the one we're about to start) than the
+         displays have room for */
+      PendingFrame frameDone;
+      frameDone.barrier      = displayGroup.ibarrier();
+      frameDone.displaysDone = false;
+      pendingFrames.push_back(frameDone);
+      ++frameID;
+      while ((int)pendingFrames.size() >= maxFramesInFlight)
+        waitForFrame(numFramesCompleted());
+      sendEngine->progress();
+      if (rateController) {
+        /* the budget is about what this frame sent; the bandwidth
+           estimate about what (of this or earlier frames) finished
+           sending in the same time that we measured. Counting this
+           frame's bytes against that time would overestimate the
+           bandwidth, since most of the frame's batches only go out
+           when we flush them above, and finish sending in the next
+           frame */
+        size_t numBytesMeasured;
+        double sendSeconds;
+        sendEngine->takeSendStats(numBytesMeasured,sendSeconds);
+        rateController->frameDone(bytesSentThisFrame.exchange(0),
+                                  numBytesMeasured,sendSeconds);
+        frameQuality     = rateController->quality();
+        frameSubsampling = rateController->subsampling();
+      }
+      keyFrame
+        = keyFrameRequested.exchange(false)
+        || (keyFrameInterval > 0 && (frameID % keyFrameInterval) == 0);
+    }
+
+    /*! returns whether the given frame is complete on all
+        displays; doesn't block */
+    bool Client::isFrameComplete(int frameID)
+    {
+      while (!pendingFrames.empty() && progressFrame(pendingFrames.front(),false))
+        popFrame();
+      return frameID < numFramesCompleted();
+    }
+
+    /*! wait until the given frame is complete on all displays */
+    void Client::waitForFrame(int frameID)
+    {
+      assert(frameID < this->frameID);
+      while (frameID >= numFramesCompleted()) {
+        progressFrame(pendingFrames.front(),true);
+        popFrame();
+      }
+    }
+
+    /*! forget about the oldest pending frame, which is complete on
+        all displays; so is its tile exchange, if any, which just
+        needs to be waited for */
+    void Client::popFrame()
+    {
+      pendingFrames.pop_front();
+      if (frameExchange)
+        frameExchange->wait();
+    }
+
+    /*! some MPIs (eg, Open MPI 4.1) let all but the root rank out of
+        a non-blocking barrier on an intercommunicator before the
+        remote group has entered it; the root gets it right, though,
+        so once the barrier with the displays is done, we enter one
+        among the clients, which nobody leaves before the root does */
+    bool Client::progressFrame(PendingFrame &frame, bool wait)
+    {
+      while (1) {
+        int done = 1;
+        if (wait) {
+          MPI_CALL(Wait(&frame.barrier,MPI_STATUS_IGNORE));
+        } else {
+          MPI_CALL(Test(&frame.barrier,&done,MPI_STATUS_IGNORE));
+        }
+        if (!done)
+          return false;
+        if (frame.displaysDone)
+          return true;
+        frame.displaysDone = true;
+        frame.barrier = clientGroup.ibarrier();
+      }
+    }
+
+    /*! wait until all frames ended so far are complete on all
+        displays */
+    void Client::waitForAllFrames()
+    {
+      if (frameID > 0)
+        waitForFrame(frameID-1);
+    }
+
+    /*! set the codec used to encode all subsequently written tiles */
+    void Client::setCodec(CodecType codec)
+    {
+      if (!TileCodec::isAvailable(codec))
+        throw std::runtime_error(std::string("tile codec '")+TileCodec::nameOf(codec)
+                                 +"' not available in this build");
+      if (!TileCodec::isSelectable(codec))
+        throw std::runtime_error(std::string("tile codec '")+TileCodec::nameOf(codec)
+                                 +"' is only used internally, per tile, and can't be selected");
+      this->codec = codec;
+      this->adaptiveCodec = false;
+    }
+
+    /*! if enabled, pick a codec per tile based on the tile's content */
+    void Client::setAdaptiveCodec(bool enabled)
+    {
+      this->adaptiveCodec = enabled;
+    }
+
+    /*! quality (1..100) to use for lossy codecs */
+    void Client::setQuality(int quality)
+    {
+      this->quality = std::max(1,std::min(100,quality));
+      if (rateController)
+        rateController->setMaxQuality(this->quality);
+      else
+        frameQuality = this->quality;
+    }
+
+    /*! adapt quality of lossy codecs to the given frame rate budget */
+    void Client::setTargetFrameRate(float fps, double linkBytesPerSecond)
+    {
+      if (fps <= 0.f) {
+        delete rateController;
+        rateController   = NULL;
+        frameQuality     = quality;
+        frameSubsampling = CHROMA_444;
+        return;
+      }
+      if (!rateController) {
+        rateController = new RateController;
+        rateController->setMaxQuality(quality);
+      }
+      rateController->setTargetFrameRate(fps);
+      rateController->setLinkBudget(linkBytesPerSecond);
+    }
+
+    /*! if enabled, only send 'unchanged' tiles for regions that have
+        the same content as in the previous frame */
+    void Client::setSkipUnchangedTiles(bool enabled)
+    {
+      skipUnchanged = enabled;
+      if (enabled && !tileHistory)
+        tileHistory = new TileHistory;
+    }
+
+    /*! if enabled, send tiles as residuals against the previous frame
+        whenever possible */
+    void Client::setDeltaEncoding(bool enabled)
+    {
+      deltaEncoding = enabled;
+      if (enabled && !tileHistory)
+        tileHistory = new TileHistory;
+    }
+
+    void Client::setKeyFrameInterval(int interval)
+    {
+      keyFrameInterval = std::max(0,interval);
+    }
+
+    /*! make the next frame a key frame */
+    void Client::requestKeyFrame()
+    {
+      keyFrameRequested = true;
+    }
+
+    /*! batch tiles per display into messages of up to this size */
+    void Client::setMaxBatchSize(size_t maxBytes)
+    {
+      batcher->maxBatchBytes = maxBytes;
+    }
+
+    /*! how many frames may be in flight at any time */
+    void Client::setMaxFramesInFlight(int maxFrames)
+    {
+      if (maxFrames > serverFramesInFlight && me.rank == 0)
+        cout << "#osp.dw: display wall only supports " << serverFramesInFlight
+             << " frames in flight" << endl;
+      maxFramesInFlight = std::max(1,std::min(maxFrames,serverFramesInFlight));
+    }
+
+    /*! limits for the asynchronous sends */
+    void Client::setSendLimits(int maxInFlight, size_t maxBacklogBytes)
+    {
+      sendEngine->maxInFlight     = std::max(1,maxInFlight);
+      sendEngine->maxBacklogBytes = maxBacklogBytes;
     }
 
-    __thread void *g_compressor = NULL;
+    /*! each render thread gets its own set of (stateful) encoders */
+    __thread CodecSet *g_codecs = NULL;
+
+    /*! pick a codec for the given tile, and encode it. with a tile
+        history, this is also where tiles get turned into 'unchanged'
+        tiles, or residuals against the previous frame */
+    void Client::encode(CompressedTile &encoded, const PlainTile &tile)
+    {
+      if (!g_codecs) g_codecs = new CodecSet;
+      CodecSet &codecs = *g_codecs;
+
+      TileHistory::Entry *entry = tileHistory ? &tileHistory->entryFor(tile) : NULL;
+      if (entry) {
+        const bool havePrevFrame = !keyFrame && entry->frameID == frameID-1;
+        entry->frameID = frameID;
+
+        if (skipUnchanged) {
+          const uint64_t hash = hashPixels(tile);
+          if (havePrevFrame && entry->hash == hash
+              && entry->quality >= frameQuality
+              && entry->subsampling <= frameSubsampling) {
+            /* display still has exactly what we sent last frame, so
+               the reference stays valid, too */
+            encoded.encode(codecs,CODEC_UNCHANGED,tile);
+            return;
+          }
+          entry->hash = hash;
+        }
+
+        if (deltaEncoding && havePrevFrame && entry->hasReference) {
+          const vec2i size = tile.size();
+          PlainTile residual(size);
+          residual.region = tile.region;
+          residual.eye    = tile.eye;
+          subtractPixels(residual.pixel,residual.pitch,
+                         tile.pixel,tile.pitch,
+                         entry->reference.data(),size.x,size);
+          encoded.encode(codecs,CODEC_DELTA,residual);
+          if (size_t(encoded.numBytes) < size.product()*sizeof(uint32_t)) {
+            packPixels(entry->reference.data(),tile);
+            entry->quality     = TILE_QUALITY_LOSSLESS;
+            entry->subsampling = CHROMA_444;
+            return;
+          }
+          /* residual doesn't compress (eg, because the camera moved),
+             so rather encode the tile itself */
+        }
+      }
+
+      CodecType tileCodec = adaptiveCodec ? classifier.classify(tile) : codec;
+      if (tileCodec == CODEC_STRIDED)
+        /* pixels can only skip the tile if they go straight to the
+           display (see writeTile()) */
+        tileCodec = CODEC_RAW;
+      encoded.encode(codecs,tileCodec,tile,frameQuality,frameSubsampling);
+
+      if (entry) {
+        const bool lossless = TileCodec::isLossless(tileCodec);
+        entry->quality     = lossless ? TILE_QUALITY_LOSSLESS : frameQuality;
+        entry->subsampling = lossless ? CHROMA_444 : frameSubsampling;
+        entry->hasReference = deltaEncoding && TileCodec::isLossless(tileCodec);
+        if (entry->hasReference) {
+          entry->reference.resize(tile.size().product());
+          packPixels(entry->reference.data(),tile);
+        }
+      }
+    }
 
     void Client::writeTile(const PlainTile &tile)
     {
       assert(wallConfig);
 
-      CompressedTile encoded;
-#if 1
-      if (!g_compressor) g_compressor = CompressedTile::createCompressor();
-      void *compressor = g_compressor;
-      encoded.encode(compressor,tile);
-#else
-      void *compressor = CompressedTile::createCompressor();
-      encoded.encode(compressor,tile);
-      CompressedTile::freeCompressor(compressor);
-#endif
-
       // -------------------------------------------------------
       // compute displays affected by this tile
       // -------------------------------------------------------
       const box2i affectedDisplays = wallConfig->affectedDisplays(tile.region);
 
-      // -------------------------------------------------------
-      // now, send to all affected displays ...
-      // -------------------------------------------------------
-
       DW_DBG(static std::atomic<int> numSent;
              numSent += tile.region.size().product();
              printf("region %i %i - %i %i displays %i %i - %i %i : %i\n",
@@ -151,9 +456,88 @@ namespace ospray {
                     (int)numSent);
              usleep(1000));
 
+      // -------------------------------------------------------
+      // now, crop the tile to each affected display, and send each
+      // display only what it actually shows; parts that fall into
+      // a bezel don't get sent at all
+      // -------------------------------------------------------
+      CompressedTile encoded;
+      auto sendPart = [&](const box2i &visible, int rank) {
+        const int tileOfs
+          = (visible.lower.x-tile.region.lower.x)
+          + tile.pitch * (visible.lower.y-tile.region.lower.y);
+        PlainTile part(tile.pixel+tileOfs,tile.pitch,tile.eye);
+        part.region = visible;
+        encode(encoded,part);
+        encoded.setFrameID(frameID);
+        if (frameExchange)
+          frameExchange->add(encoded,rank);
+        else if (!localRings.empty() && localRings[rank])
+          localRings[rank]->push(encoded);
+        else
+          batcher->send(encoded,rank);
+        bytesSentThisFrame += encoded.numBytes;
+      };
+
+      /* raw pixels, as a message of their own, with a small tile
+         (batched like all others) that tells the display where they
+         go. Both go through the send engine, so we don't wait for
+         either; since the caller may re-use the tile's memory once
+         we return, the pixels go from a (pooled) copy, which the
+         engine keeps until they're sent */
+      auto sendStrided = [&](const box2i &visible, int rank) {
+        const int tileOfs
+          = (visible.lower.x-tile.region.lower.x)
+          + tile.pitch * (visible.lower.y-tile.region.lower.y);
+        PlainTile part(tile.pixel+tileOfs,tile.pitch,tile.eye);
+        part.region = visible;
+        const int tag
+          = STRIDED_PIXELS_TAG + (numStridedTiles++ % STRIDED_PIXELS_NUM_TAGS);
+        TileBatch pixels;
+        pixels.reserve(visible.size().product()*sizeof(uint32_t));
+        packPixels((uint32_t *)pixels.data,part);
+        pixels.numBytes = visible.size().product()*sizeof(uint32_t);
+        sendEngine->send(pixels,rank,tag);
+        encoded.encodeStrided(part,tag);
+        encoded.setFrameID(frameID);
+        batcher->send(encoded,rank);
+        bytesSentThisFrame += encoded.numBytes + visible.size().product()*sizeof(uint32_t);
+      };
+
+      if (!headNodeRegions.empty()) {
+        /* the head nodes do the per-display part; all we have to do
+           is give each head node its share of the tile */
+        for (int rank=0;rank<(int)headNodeRegions.size();rank++) {
+          const box2i visible = intersectionOf(tile.region,headNodeRegions[rank]);
+          const vec2i visibleSize = visible.size();
+          if (visibleSize.x > 0 && visibleSize.y > 0)
+            sendPart(visible,rank);
+        }
+        return;
+      }
+
       for (int dy=affectedDisplays.lower.y;dy<affectedDisplays.upper.y;dy++)
-        for (int dx=affectedDisplays.lower.x;dx<affectedDisplays.upper.x;dx++) 
-          encoded.sendTo(displayGroup,wallConfig->rankOfDisplay(vec2i(dx,dy)));
+        for (int dx=affectedDisplays.lower.x;dx<affectedDisplays.upper.x;dx++) {
+          const vec2i displayID(dx,dy);
+          const box2i visible
+            = intersectionOf(tile.region,wallConfig->regionOfDisplay(displayID));
+          const vec2i visibleSize = visible.size();
+          if (visibleSize.x <= 0 || visibleSize.y <= 0)
+            continue;
+          if (frameWindow) {
+            /* no encoding, no messages: just write the pixels into
+               place */
+            frameWindow->put(tile,visible,wallConfig->rankOfDisplay(displayID),frameID);
+            bytesSentThisFrame += visibleSize.product()*sizeof(uint32_t);
+          } else if (codec == CODEC_STRIDED && !adaptiveCodec && !frameExchange
+                     && (localRings.empty() || !localRings[wallConfig->rankOfDisplay(displayID)]))
+            /* (tiles for local displays go through shared memory, and
+               collectively exchanged ones with all other tiles, as
+               raw tiles; see encode()) */
+            sendStrided(visible,wallConfig->rankOfDisplay(displayID));
+          else
+            sendPart(visible,wallConfig->rankOfDisplay(displayID));
+        }
     }
 
 
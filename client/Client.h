@@ -23,6 +23,17 @@ SOFTWARE.
 #include "../common/MPI.h"
 #include "../common/WallConfig.h"
 #include "../common/CompressedTile.h"
+#include "../common/TileBatch.h"
+#include "../common/SendEngine.h"
+#include "../common/FrameWindow.h"
+#include "../common/FrameExchange.h"
+#include "../common/ShmTileRing.h"
+#include "TileClassifier.h"
+#include "TileHistory.h"
+#include "RateController.h"
+#include <atomic>
+#include <deque>
+#include <vector>
 
 namespace ospray {
   namespace dw {
@@ -72,17 +83,161 @@ namespace ospray {
           know how large a frame buffer to use ... */
       vec2i totalPixelsInWall() const;
       void writeTile(const PlainTile &tile);
+      /*! end the current frame; this doesn't wait for the displays
+          to complete it unless that would make more frames in
+          flight than allowed (see setMaxFramesInFlight()) */
       void endFrame();
+      /*! @{ frames are numbered by the number of endFrame()s before
+          them; these have to be called on the same thread as
+          endFrame(). isFrameComplete() returns whether the given
+          frame has been completed on all displays, without
+          blocking; waitForFrame() waits until it has */
+      int  getFrameID() const { return frameID; }
+      bool isFrameComplete(int frameID);
+      void waitForFrame(int frameID);
+      void waitForAllFrames();
+      /*! @} */
+
+      /*! set the codec used to encode all subsequently written
+          tiles; this disables adaptive codec selection. Throws for
+          codecs that are only used internally (see
+          TileCodec::isSelectable()) */
+      void setCodec(CodecType codec);
+      CodecType getCodec() const { return codec; }
+      /*! if enabled, pick a codec per tile based on the tile's
+          content (solid color, lossless, or lossy; see
+          TileClassifier) */
+      void setAdaptiveCodec(bool enabled);
+      /*! quality (1..100) to use for lossy codecs; with a target
+          frame rate, this is the maximum quality */
+      void setQuality(int quality);
+      /*! if fps > 0, adjust quality and chroma subsampling of lossy
+          codecs every frame such that what this client sends fits
+          into 1/fps seconds of the given link bandwidth (in
+          bytes/second; 0 means 'measure it'), see RateController;
+          fps <= 0 goes back to a fixed quality */
+      void setTargetFrameRate(float fps, double linkBytesPerSecond = 0.);
+      /*! if enabled, tiles whose content is the same as in the
+          previous frame only get sent as an 'unchanged' tile, without
+          any pixels (the display re-uses its previous frame's pixels
+          for those) */
+      void setSkipUnchangedTiles(bool enabled);
+      /*! if enabled, tiles get sent as lossless residuals against
+          what this client sent for the same region in the previous
+          frame (if that was lossless), whenever that is smaller */
+      void setDeltaEncoding(bool enabled);
+      /*! with delta encoding, force a key frame (ie, a frame without
+          any references to previous frames) every 'interval' frames;
+          0 means 'never' */
+      void setKeyFrameInterval(int interval);
+      /*! make the next frame a key frame */
+      void requestKeyFrame();
+      /*! tiles for the same display get collected into one message
+          of up to this many bytes (or until the frame ends, or a few
+          milliseconds have passed); 0 sends every tile as soon as it
+          is encoded */
+      void setMaxBatchSize(size_t maxBytes);
+      /*! batches get sent asynchronously, with at most 'maxInFlight'
+          sends posted at any time; once more than 'maxBacklogBytes'
+          are waiting to be sent, writeTile() blocks until enough
+          have gone out */
+      void setSendLimits(int maxInFlight, size_t maxBacklogBytes);
+      /*! let this client start sending the next frame(s) before the
+          displays have completed the previous one(s): endFrame() only
+          waits for the displays once more than 'maxFrames' frames
+          are in flight. 1 (the default) waits for every frame; the
+          maximum is what the display wall was started with */
+      void setMaxFramesInFlight(int maxFrames);
 
       const WallConfig *getWallConfig() const { return wallConfig; }
     private:
+      /*! pick a codec for the given tile, and encode it */
+      void encode(CompressedTile &encoded, const PlainTile &tile);
       void receiveDisplayConfig();
       /*! establish connection between 'me' and the remote service */
       void establishConnection(const std::string &portName);
 
       WallConfig *wallConfig;
+      /*! with head nodes on the service side: the pixel region each
+          head node is responsible for (indexed by the head node's
+          rank in displayGroup); tiles get cropped to, and sent to,
+          these regions instead of the actual displays */
+      std::vector<box2i> headNodeRegions;
+      /*! if the display wall wants it (see
+          ServiceOptions::putFrames): the displays' receive buffers,
+          which we write raw pixels into instead of sending them
+          tiles; codecs, unchanged tiles, and delta encoding don't
+          apply then. NULL otherwise */
+      FrameWindow *frameWindow;
+      /*! if the display wall wants it (see
+          ServiceOptions::exchangeFrames): collects each frame's
+          tiles for all displays, and sends them in one collective
+          exchange at the end of the frame. NULL otherwise */
+      FrameExchange *frameExchange;
+      /*! tile rings to the displays on our own node (by display
+          rank; NULL for all others), which get their tiles through
+          those instead of MPI; empty if the display wall doesn't do
+          that (see ServiceOptions::sharedMemoryTiles) */
+      std::vector<ShmTileRing *> localRings;
+      /*! codec used for encoding tiles (if not adaptive); with
+          CODEC_STRIDED, tiles' pixels go as messages of their own
+          (or, with head nodes, as CODEC_RAW) */
+      CodecType codec;
+      /*! number of strided tiles sent so far, for their pixel
+          messages' tags (see STRIDED_PIXELS_TAG) */
+      std::atomic<int> numStridedTiles;
+      /*! whether to pick codecs per tile, via 'classifier' */
+      bool adaptiveCodec;
+      TileClassifier classifier;
+      /*! quality for lossy codecs */
+      int quality;
+      /*! NULL if quality is fixed */
+      RateController *rateController;
+      /*! quality and chroma subsampling for lossy codecs in the
+          current frame */
+      int frameQuality;
+      ChromaSubsampling frameSubsampling;
+      /*! what we sent in the current frame, for the rate controller */
+      std::atomic<size_t>  bytesSentThisFrame;
+      /*! what we sent in previous frames; NULL if we neither skip
+          unchanged tiles nor use delta encoding */
+      TileHistory *tileHistory;
+      bool skipUnchanged;
+      bool deltaEncoding;
+      int  keyFrameInterval;
+      std::atomic<bool> keyFrameRequested;
+      /*! whether the current frame is a key frame */
+      bool keyFrame;
+      /*! number of frames this client has ended so far */
+      int frameID;
+      int maxFramesInFlight;
+      /*! max frames in flight the display wall has room for */
+      int serverFramesInFlight;
+      /*! a frame that was ended, but isn't yet known to be complete
+          on all displays: first, its (non-blocking) barrier with the
+          displays, and then one among the clients (see
+          progressFrame()) */
+      struct PendingFrame {
+        MPI_Request barrier;
+        bool        displaysDone;
+      };
+      /*! advance the frame's barriers (waiting for them if 'wait');
+          returns whether the frame is complete */
+      bool progressFrame(PendingFrame &frame, bool wait);
+      /*! drop the oldest pending frame, once it is complete */
+      void popFrame();
+      /*! frames ended, but not yet known to be complete, oldest first */
+      std::deque<PendingFrame> pendingFrames;
+      int numFramesCompleted() const { return frameID - (int)pendingFrames.size(); }
+      /*! sends batches in the background */
+      SendEngine  *sendEngine;
+      /*! collects encoded tiles into one message per display */
+      TileBatcher *batcher;
       MPI::Group displayGroup;
       MPI::Group me;
+      /*! a copy of 'me' for the clients' per-frame barriers, so those
+          can't get mixed up with whatever else the app does on 'me' */
+      MPI::Group clientGroup;
     };
 
   } // ::ospray::dw
@@ -0,0 +1,107 @@
+/* 
+Copyright (c) 2016-17 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "RateController.h"
+#include <algorithm>
+
+namespace ospray {
+  namespace dw {
+
+    /*! weight of the newest sample in the bandwidth estimate */
+#define BANDWIDTH_SMOOTHING  .2
+    /*! frames below this fraction of the budget raise the quality */
+#define HEADROOM_RATIO       .8
+    /*! how much quality we gain per frame with headroom */
+#define QUALITY_STEP_UP      5
+
+    RateController::RateController()
+      : minQuality(20),
+        targetFPS(30.f),
+        linkBudget(0.),
+        measuredBandwidth(0.),
+        maxQuality(100),
+        currentQuality(100),
+        currentSubsampling(CHROMA_444)
+    {}
+
+    void RateController::setTargetFrameRate(float fps)
+    {
+      targetFPS = std::max(1.f,fps);
+    }
+
+    void RateController::setLinkBudget(double bytesPerSecond)
+    {
+      linkBudget = std::max(0.,bytesPerSecond);
+    }
+
+    void RateController::setMaxQuality(int quality)
+    {
+      maxQuality = std::max(minQuality,std::min(100,quality));
+      currentQuality = std::min(currentQuality,maxQuality);
+    }
+
+    void RateController::frameDone(size_t numBytesSent,
+                                   size_t numBytesMeasured, double sendSeconds)
+    {
+      if (numBytesMeasured > 0 && sendSeconds > 0.) {
+        const double sample = numBytesMeasured / sendSeconds;
+        measuredBandwidth
+          = (measuredBandwidth == 0.)
+          ? sample
+          : (1.-BANDWIDTH_SMOOTHING)*measuredBandwidth + BANDWIDTH_SMOOTHING*sample;
+      }
+      const double bandwidth = linkBudget > 0. ? linkBudget : measuredBandwidth;
+      if (bandwidth <= 0.)
+        // nothing we can base a decision on, yet
+        return;
+
+      const double budget = bandwidth / targetFPS;
+      const double ratio  = numBytesSent / budget;
+      if (ratio > 1.) {
+        // over budget: drop quality in proportion to how far over we
+        // are, but at most halfway to the minimum per frame
+        const float excess = std::min(.5f,float(1.-1./ratio));
+        currentQuality -= std::max(1,int(excess*(currentQuality-minQuality)+.5f));
+      } else if (ratio < HEADROOM_RATIO) {
+        currentQuality += QUALITY_STEP_UP;
+      }
+      currentQuality = std::max(minQuality,std::min(maxQuality,currentQuality));
+
+      // coarser chroma at lower qualities, with some hysteresis so we
+      // don't toggle back and forth every frame
+      switch (currentSubsampling) {
+      case CHROMA_444:
+        if (currentQuality < 75) currentSubsampling = CHROMA_422;
+        break;
+      case CHROMA_422:
+        if (currentQuality >= 90) currentSubsampling = CHROMA_444;
+        else if (currentQuality < 50) currentSubsampling = CHROMA_420;
+        break;
+      default:
+        if (currentQuality >= 60) currentSubsampling = CHROMA_422;
+        break;
+      }
+    }
+
+  } // ::ospray::dw
+} // ::ospray
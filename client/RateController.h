@@ -0,0 +1,80 @@
+/* 
+Copyright (c) 2016-17 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "../common/TileCodec.h"
+
+namespace ospray {
+  namespace dw {
+
+    /*! picks quality and chroma subsampling for lossy codecs, once
+        per frame, such that what we send fits a frame rate budget:
+        with a target frame rate and a link bandwidth (either given,
+        or measured from how long our sends take), each frame has a
+        byte budget; frames that exceed it lower the quality for the
+        next frame (and, at lower qualities, switch to coarser chroma
+        subsampling), frames well under budget - eg, because the
+        view is still, and most tiles are unchanged or small deltas -
+        raise it again until it's back at the maximum */
+    struct RateController {
+      RateController();
+
+      /*! frame rate (frames/second) we want to sustain */
+      void setTargetFrameRate(float fps);
+      /*! bandwidth (bytes/second) this client may use; 0 means
+          'estimate from measured send times' */
+      void setLinkBudget(double bytesPerSecond);
+      /*! quality the controller converges back to when there's
+          headroom */
+      void setMaxQuality(int quality);
+
+      /*! report how many bytes the frame we just finished sent (which
+          gets compared against the budget), and how many bytes
+          finished sending in how many seconds of sending since the
+          last call (which the bandwidth estimate is based on; see
+          SendEngine::takeSendStats()); updates quality and
+          subsampling for the next frame */
+      void frameDone(size_t numBytesSent,
+                     size_t numBytesMeasured, double sendSeconds);
+
+      int quality() const { return currentQuality; }
+      ChromaSubsampling subsampling() const { return currentSubsampling; }
+
+      /*! never go below this quality */
+      int minQuality;
+
+    private:
+      float  targetFPS;
+      double linkBudget;
+      /*! running average of measured bytes/second (a lower bound,
+          since sends may complete a little before we notice); 0 if
+          unknown */
+      double measuredBandwidth;
+      int    maxQuality;
+      int    currentQuality;
+      ChromaSubsampling currentSubsampling;
+    };
+
+  } // ::ospray::dw
+} // ::ospray
@@ -0,0 +1,99 @@
+/* 
+Copyright (c) 2016-17 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "TileClassifier.h"
+#include <math.h>
+
+namespace ospray {
+  namespace dw {
+
+    /*! max number of pixel pairs we look at for the entropy estimate */
+#define MAX_SAMPLES 256
+
+    TileClassifier::TileClassifier()
+      : losslessCodec(CODEC_QOI),
+        lossyCodec(CODEC_JPEG),
+        maxLosslessEntropy(3.f)
+    {}
+
+    /*! returns whether all pixels in the tile have the same value */
+    inline bool isSolid(const PlainTile &tile)
+    {
+      const vec2i size = tile.size();
+      const uint32_t color = tile.pixel[0];
+      for (int iy=0;iy<size.y;iy++) {
+        const uint32_t *row = tile.pixel + iy*tile.pitch;
+        for (int ix=0;ix<size.x;ix++)
+          if (row[ix] != color) return false;
+      }
+      return true;
+    }
+
+    /*! estimate the tile's entropy (in bits per channel) from a
+        histogram of the differences between horizontally
+        neighboring pixels, sampled on a sparse grid */
+    inline float estimateEntropy(const PlainTile &tile)
+    {
+      const vec2i size = tile.size();
+      if (size.x < 2) return 0.f;
+
+      // sample stride that gives us at most ~MAX_SAMPLES pixel pairs
+      const int numPairs = (size.x-1)*size.y;
+      const int stride   = std::max(1,(int)sqrtf(numPairs/(float)MAX_SAMPLES));
+
+      int histogram[256];
+      memset(histogram,0,sizeof(histogram));
+      int numSamples = 0;
+      for (int iy=0;iy<size.y;iy+=stride) {
+        const unsigned char *row = (const unsigned char *)(tile.pixel + iy*tile.pitch);
+        for (int ix=0;ix<size.x-1;ix+=stride) {
+          const unsigned char *a = row + 4*ix;
+          const unsigned char *b = a + 4;
+          for (int c=0;c<3;c++)
+            histogram[(unsigned char)(b[c]-a[c])]++;
+          numSamples += 3;
+        }
+      }
+
+      float entropy = 0.f;
+      for (int i=0;i<256;i++) {
+        if (!histogram[i]) continue;
+        const float p = histogram[i]/float(numSamples);
+        entropy -= p * log2f(p);
+      }
+      return entropy;
+    }
+
+    /*! pick the codec for the given tile */
+    CodecType TileClassifier::classify(const PlainTile &tile) const
+    {
+      if (tile.size().product() <= 0)
+        return CODEC_RAW;
+      if (isSolid(tile))
+        return CODEC_SOLID;
+      if (estimateEntropy(tile) <= maxLosslessEntropy)
+        return losslessCodec;
+      return TileCodec::isAvailable(lossyCodec) ? lossyCodec : CODEC_RAW;
+    }
+
+  } // ::ospray::dw
+} // ::ospray
@@ -0,0 +1,54 @@
+/* 
+Copyright (c) 2016-17 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "../common/CompressedTile.h"
+
+namespace ospray {
+  namespace dw {
+
+    /*! a cheap content classifier that picks a codec for each tile:
+        a solid color for flat tiles, a lossless codec for tiles with
+        little detail (flat regions, smooth gradients, etc), and a
+        lossy codec for tiles with lots of high-frequency detail (for
+        which lossless codecs don't buy much) */
+    struct TileClassifier {
+      TileClassifier();
+
+      /*! pick the codec for the given tile */
+      CodecType classify(const PlainTile &tile) const;
+
+      /*! codec to use for tiles with little detail */
+      CodecType losslessCodec;
+      /*! codec to use for tiles with lots of detail; if this isn't
+          available in this build we use the raw codec instead (the
+          lossless codecs would only expand such tiles) */
+      CodecType lossyCodec;
+      /*! estimated entropy (in bits per channel, of the sampled
+          neighbor differences) above which a tile counts as
+          'detailed' */
+      float     maxLosslessEntropy;
+    };
+
+  } // ::ospray::dw
+} // ::ospray
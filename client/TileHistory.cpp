@@ -0,0 +1,81 @@
+/* 
+Copyright (c) 2016-17 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "TileHistory.h"
+
+namespace ospray {
+  namespace dw {
+
+    inline uint64_t mix64(uint64_t h)
+    {
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccdULL;
+      h ^= h >> 33;
+      h *= 0xc4ceb9fe1a85ec53ULL;
+      h ^= h >> 33;
+      return h;
+    }
+
+    /*! compute a 64-bit hash of the tile's pixel content */
+    uint64_t hashPixels(const PlainTile &tile)
+    {
+      const vec2i size = tile.size();
+      uint64_t h = mix64(uint64_t(size.x) << 32 | uint64_t(size.y));
+      for (int iy=0;iy<size.y;iy++) {
+        const uint32_t *row = tile.pixel + iy*tile.pitch;
+        int ix = 0;
+        for (;ix+2<=size.x;ix+=2) {
+          uint64_t v;
+          memcpy(&v,row+ix,sizeof(v));
+          h = (h ^ v) * 0x100000001b3ULL;
+          h ^= h >> 29;
+        }
+        if (ix < size.x)
+          h = (h ^ row[ix]) * 0x100000001b3ULL;
+      }
+      return mix64(h);
+    }
+
+    size_t TileHistory::KeyHash::operator()(const Key &key) const
+    {
+      return mix64((uint64_t(key.region.lower.x) << 40)
+                   ^ (uint64_t(key.region.lower.y) << 20)
+                   ^ (uint64_t(key.region.upper.x) << 8)
+                   ^ uint64_t(key.region.upper.y)
+                   ^ (uint64_t(key.eye) << 62));
+    }
+
+    TileHistory::Entry &TileHistory::entryFor(const PlainTile &tile)
+    {
+      Key key;
+      key.region = tile.region;
+      key.eye    = tile.eye;
+
+      Shard &s = shard[KeyHash()(key) % TILE_HISTORY_SHARDS];
+      std::lock_guard<std::mutex> lock(s.mutex);
+      /* note: unordered_map never invalidates references to its
+         elements, not even when rehashing */
+      return s.entries[key];
+    }
+
+  } // ::ospray::dw
+} // ::ospray
@@ -0,0 +1,98 @@
+/* 
+Copyright (c) 2016-17 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "../common/CompressedTile.h"
+#include <mutex>
+#include <unordered_map>
+
+namespace ospray {
+  namespace dw {
+
+    /*! what this client sent for each region (and eye) in recent
+        frames - used to detect tiles whose content did not change
+        since the previous frame, and as reference for delta
+        encoding.
+
+        Note that renderers can (and do) assign the same region to
+        different client ranks in different frames, so an entry is
+        only trusted if it was written in the _immediately_ previous
+        frame: only then do we know the display currently holds
+        exactly what we sent */
+#define TILE_QUALITY_LOSSLESS 1000
+
+    struct TileHistory {
+      /*! what this client sent for one region */
+      struct Entry {
+        /*! hash of the pixels sent for this region */
+        uint64_t hash    { 0 };
+        /*! frame in which this client last wrote this region */
+        int      frameID { -2 };
+        /*! if the last tile sent for this region was lossless: the
+            exact pixels the display now has for it (dense, ie, with a
+            pitch of region.size().x) - needed for delta encoding */
+        std::vector<uint32_t> reference;
+        bool     hasReference { false };
+        /*! quality and chroma subsampling the display has this
+            region's pixels in (TILE_QUALITY_LOSSLESS and CHROMA_444
+            if they were sent losslessly); a region only counts as
+            unchanged if it was sent at least as well as we'd send it
+            now */
+        int      quality { 0 };
+        ChromaSubsampling subsampling { CHROMA_444 };
+      };
+
+      /*! get the entry for the given tile's region and eye (creating
+          a new one if required). Renderers write every region at
+          most once per frame, so the entry can be used without
+          holding any lock once we return it */
+      Entry &entryFor(const PlainTile &tile);
+
+    private:
+      /*! key to identify a region/eye */
+      struct Key {
+        box2i region;
+        int   eye;
+        bool operator==(const Key &other) const
+        { return region.lower == other.region.lower
+            && region.upper == other.region.upper
+            && eye == other.eye; }
+      };
+      struct KeyHash {
+        size_t operator()(const Key &key) const;
+      };
+
+      /*! we shard the map by region, so render threads writing
+          different tiles rarely contend for the same lock */
+#define TILE_HISTORY_SHARDS 64
+      struct Shard {
+        std::mutex mutex;
+        std::unordered_map<Key,Entry,KeyHash> entries;
+      } shard[TILE_HISTORY_SHARDS];
+    };
+
+    /*! compute a 64-bit hash of the tile's pixel content */
+    uint64_t hashPixels(const PlainTile &tile);
+
+  } // ::ospray::dw
+} // ::ospray
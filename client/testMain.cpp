@@ -90,18 +90,65 @@ namespace ospray {
       MPI::Group world(MPI_COMM_WORLD);
 
       std::string portName = "";
+      CodecType codec = TileCodec::defaultType();
+      bool adaptiveCodec = false;
+      int quality = 100;
+      bool skipUnchanged = false;
+      bool deltaEncoding = false;
+      int keyFrameInterval = 0;
+      float targetFPS = 0.f;
+      float linkBudgetMB = 0.f;
+      int batchSizeKB = 256;
+      int maxSendsInFlight = 64;
+      int sendBacklogMB = 64;
+      int maxFramesInFlight = 1;
 
       std::vector<std::string> nonDashArgs;
       for (int i=1;i<ac;i++) {
         const std::string arg = av[i];
-        if (arg[0] == '-') {
+        if (arg == "--codec" || arg == "-c") {
+          assert(i+1<ac);
+          const std::string codecName = av[++i];
+          if (codecName == "auto")
+            adaptiveCodec = true;
+          else
+            codec = TileCodec::typeOf(codecName);
+        } else if (arg == "--quality" || arg == "-q") {
+          assert(i+1<ac);
+          quality = atoi(av[++i]);
+        } else if (arg == "--skip-unchanged" || arg == "-su") {
+          skipUnchanged = true;
+        } else if (arg == "--delta" || arg == "-d") {
+          deltaEncoding = true;
+        } else if (arg == "--key-frame-interval" || arg == "-kfi") {
+          assert(i+1<ac);
+          keyFrameInterval = atoi(av[++i]);
+        } else if (arg == "--target-fps" || arg == "-fps") {
+          assert(i+1<ac);
+          targetFPS = atof(av[++i]);
+        } else if (arg == "--link-budget" || arg == "-lb") {
+          assert(i+1<ac);
+          linkBudgetMB = atof(av[++i]);
+        } else if (arg == "--batch-size" || arg == "-bs") {
+          assert(i+1<ac);
+          batchSizeKB = atoi(av[++i]);
+        } else if (arg == "--max-in-flight" || arg == "-mif") {
+          assert(i+1<ac);
+          maxSendsInFlight = atoi(av[++i]);
+        } else if (arg == "--send-backlog" || arg == "-sb") {
+          assert(i+1<ac);
+          sendBacklogMB = atoi(av[++i]);
+        } else if (arg == "--frames-in-flight" || arg == "-fif") {
+          assert(i+1<ac);
+          maxFramesInFlight = atoi(av[++i]);
+        } else if (arg[0] == '-') {
           throw std::runtime_error("unknown arg "+arg);
         } else
           nonDashArgs.push_back(arg);
       }
 
       if (nonDashArgs.size() != 2) {
-        cout << "Usage: ./ospDwTest <hostName> <portNo>" << endl;
+        cout << "Usage: ./ospDwTest [--codec|-c raw|strided|lz|qoi|jpeg|auto] [--quality|-q <1..100>] [--skip-unchanged|-su] [--delta|-d] [--key-frame-interval|-kfi <n>] [--target-fps|-fps <fps>] [--link-budget|-lb <MB/s>] [--batch-size|-bs <KB>] [--max-in-flight|-mif <n>] [--send-backlog|-sb <MB>] [--frames-in-flight|-fif <n>] <hostName> <portNo>" << endl;
         exit(1);
       }
       const std::string hostName = nonDashArgs[0];
@@ -115,6 +162,16 @@ namespace ospray {
       // -------------------------------------------------------
       MPI::Group me = world.dup();
       Client *client = new Client(me,serviceInfo.mpiPortName);
+      client->setCodec(codec);
+      client->setAdaptiveCodec(adaptiveCodec);
+      client->setQuality(quality);
+      client->setSkipUnchangedTiles(skipUnchanged);
+      client->setDeltaEncoding(deltaEncoding);
+      client->setKeyFrameInterval(keyFrameInterval);
+      client->setTargetFrameRate(targetFPS,linkBudgetMB*1e6);
+      client->setMaxBatchSize(size_t(std::max(0,batchSizeKB))*1024);
+      client->setSendLimits(maxSendsInFlight,size_t(std::max(0,sendBacklogMB))<<20);
+      client->setMaxFramesInFlight(maxFramesInFlight);
 
       while (1)
         renderFrame(me,client);
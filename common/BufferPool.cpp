@@ -0,0 +1,165 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "BufferPool.h"
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include <new>
+#include <stdlib.h>
+
+namespace ospray {
+  namespace dw {
+
+    /*! smallest size class is 2^POOL_MIN_CLASS_LOG bytes ... */
+#define POOL_MIN_CLASS_LOG 8
+    /*! ... and the largest one 2^(POOL_MIN_CLASS_LOG+POOL_NUM_CLASSES-1);
+        anything larger bypasses the pool */
+#define POOL_NUM_CLASSES   22
+    /*! max number of buffers per size class we keep in a thread's cache */
+#define POOL_THREAD_CACHE  32
+    /*! max number of bytes per size class we keep in the shared pool
+        (but always at least one buffer); we free anything beyond
+        that, so a burst of large frames doesn't pin its memory for
+        the rest of the run */
+#define POOL_SHARED_BYTES  (16*1024*1024)
+    /*! size class of buffers that bypass the pool */
+#define POOL_UNPOOLED      (size_t)-1
+
+    /*! sits in front of every buffer we hand out; 16 bytes, to keep
+        the buffer itself 16-byte aligned */
+    struct BufferHeader {
+      size_t sizeClass;
+      size_t capacity;
+    };
+
+    /*! buffers that overflowed some thread's cache */
+    struct SharedPool {
+      /*! keep the given buffer (with mutex held), or free it if we
+          already have enough of its size class */
+      void releaseLocked(void *buffer, size_t sizeClass);
+
+      std::mutex         mutex;
+      std::vector<void*> free[POOL_NUM_CLASSES];
+    };
+
+    /*! never destroyed, since threads may still release buffers
+        while static objects get destructed */
+    static SharedPool &sharedPool()
+    {
+      static SharedPool *pool = new SharedPool;
+      return *pool;
+    }
+
+    struct ThreadCache {
+      ~ThreadCache()
+      {
+        SharedPool &shared = sharedPool();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        for (int c=0;c<POOL_NUM_CLASSES;c++)
+          for (int i=0;i<numFree[c];i++)
+            shared.releaseLocked(free[c][i],c);
+      }
+
+      void *free[POOL_NUM_CLASSES][POOL_THREAD_CACHE];
+      int   numFree[POOL_NUM_CLASSES] = { 0 };
+    };
+
+    static thread_local ThreadCache threadCache;
+
+    inline size_t sizeClassOf(size_t numBytes)
+    {
+      size_t c = 0;
+      while (c < POOL_NUM_CLASSES && (size_t(1) << (c+POOL_MIN_CLASS_LOG)) < numBytes)
+        ++c;
+      return c < POOL_NUM_CLASSES ? c : POOL_UNPOOLED;
+    }
+
+    inline BufferHeader *headerOf(const void *buffer)
+    { return (BufferHeader *)buffer - 1; }
+
+    void SharedPool::releaseLocked(void *buffer, size_t sizeClass)
+    {
+      const size_t maxFree
+        = std::max(size_t(1),size_t(POOL_SHARED_BYTES) >> (sizeClass+POOL_MIN_CLASS_LOG));
+      if (free[sizeClass].size() < maxFree)
+        free[sizeClass].push_back(buffer);
+      else
+        ::free(headerOf(buffer));
+    }
+
+    void *BufferPool::allocate(size_t numBytes)
+    {
+      const size_t sizeClass = sizeClassOf(numBytes);
+      BufferHeader *header = NULL;
+      if (sizeClass != POOL_UNPOOLED) {
+        ThreadCache &cache = threadCache;
+        if (cache.numFree[sizeClass] > 0)
+          return cache.free[sizeClass][--cache.numFree[sizeClass]];
+
+        SharedPool &shared = sharedPool();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        if (!shared.free[sizeClass].empty()) {
+          void *buffer = shared.free[sizeClass].back();
+          shared.free[sizeClass].pop_back();
+          return buffer;
+        }
+      }
+
+      const size_t capacity
+        = (sizeClass == POOL_UNPOOLED)
+        ? numBytes
+        : (size_t(1) << (sizeClass+POOL_MIN_CLASS_LOG));
+      header = (BufferHeader *)malloc(sizeof(BufferHeader)+capacity);
+      if (!header) throw std::bad_alloc();
+      header->sizeClass = sizeClass;
+      header->capacity  = capacity;
+      return header+1;
+    }
+
+    void BufferPool::release(void *buffer)
+    {
+      if (!buffer) return;
+      BufferHeader *header = headerOf(buffer);
+      const size_t sizeClass = header->sizeClass;
+      if (sizeClass == POOL_UNPOOLED) {
+        ::free(header);
+        return;
+      }
+
+      ThreadCache &cache = threadCache;
+      if (cache.numFree[sizeClass] < POOL_THREAD_CACHE) {
+        cache.free[sizeClass][cache.numFree[sizeClass]++] = buffer;
+        return;
+      }
+      SharedPool &shared = sharedPool();
+      std::lock_guard<std::mutex> lock(shared.mutex);
+      shared.releaseLocked(buffer,sizeClass);
+    }
+
+    size_t BufferPool::capacityOf(const void *buffer)
+    {
+      return buffer ? headerOf(buffer)->capacity : 0;
+    }
+
+  } // ::ospray::dw
+} // ::ospray
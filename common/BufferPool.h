@@ -0,0 +1,52 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+namespace ospray {
+  namespace dw {
+
+    /*! a pool of recycled byte buffers, for the per-tile buffers
+        (encoded tiles, received messages, plain tiles) that we'd
+        otherwise malloc and free many thousand times per frame.
+
+        Buffers come in power-of-two size classes; released buffers
+        go to a small per-thread cache for their class (no locking),
+        and only overflow into (or, if the thread's cache is empty,
+        get taken from) a shared, mutex-protected list, which frees
+        whatever exceeds its per-class limit. Buffers may be released
+        on a different thread than they were allocated on. */
+    struct BufferPool {
+      /*! get a buffer of at least 'numBytes' bytes, 16-byte aligned */
+      static void *allocate(size_t numBytes);
+      /*! give a buffer obtained through allocate() back to the pool;
+          NULL is ignored */
+      static void release(void *buffer);
+      /*! number of bytes actually usable in given buffer (ie, the
+          size of its size class) */
+      static size_t capacityOf(const void *buffer);
+    };
+
+  } // ::ospray::dw
+} // ::ospray
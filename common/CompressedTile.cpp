@@ -21,103 +21,132 @@ SOFTWARE.
 */
 
 #include "CompressedTile.h"
-#include <atomic>
-
-#if TURBO_JPEG
-# include "turbojpeg.h"
-# define JPEG_QUALITY 100
-#endif
+#include <algorithm>
 
 namespace ospray {
   namespace dw {
 
-#if TURBO_JPEG
-    void *CompressedTile::createCompressor() { return (void *)tjInitCompress(); }
-    void *CompressedTile::createDecompressor() { return (void *)tjInitDecompress(); }
-    void CompressedTile::freeCompressor(void *compressor) { tjDestroy((tjhandle)compressor); }
-    void CompressedTile::freeDecompressor(void *decompressor) { tjDestroy((tjhandle)decompressor); }
-#else
-    void *CompressedTile::createCompressor() { return NULL; }
-    void *CompressedTile::createDecompressor() { return NULL; }
-    void CompressedTile::freeCompressor(void *) {}
-    void CompressedTile::freeDecompressor(void *) {}
-#endif
-
     struct CompressedTileHeader {
       box2i region;
       int   eye;
+      /*! the CodecType this tile's payload was encoded with */
+      int   codec;
+      /*! the (client-side) frame this tile belongs to */
+      int   frameID;
+      /*! @{ what a lossy codec encoded this tile with (100 and
+          CHROMA_444 for lossless ones); also keeps the payload 8-byte
+          aligned */
+      short quality;
+      short subsampling;
+      /*! @} */
       unsigned char payload[0];
     };
 
     CompressedTile::CompressedTile() 
       : fromRank(-1), 
         numBytes(-1), 
-        data(NULL) 
+        data(NULL),
+        ownsData(true)
+    {}
+
+    CompressedTile::CompressedTile(unsigned char *data, int numBytes, int fromRank)
+      : data(data),
+        fromRank(fromRank),
+        numBytes(numBytes),
+        ownsData(false)
     {}
 
     CompressedTile::~CompressedTile() 
     { 
-      if (data) delete[] data; 
+      if (ownsData) BufferPool::release(data);
+    }
+
+    void CompressedTile::reserve(size_t numBytes)
+    {
+      if (!ownsData) {
+        data = NULL;
+        ownsData = true;
+      }
+      if (BufferPool::capacityOf(data) >= numBytes)
+        return;
+      BufferPool::release(data);
+      data = (unsigned char *)BufferPool::allocate(numBytes);
     }
 
-    void CompressedTile::encode(void *compressor, const PlainTile &tile)
+    void CompressedTile::encode(CodecSet &codecs, CodecType codecType, const PlainTile &tile,
+                                int quality, ChromaSubsampling subsampling)
     {
       assert(tile.pixel);
-      const vec2i begin = tile.region.lower;
-      const vec2i end   = tile.region.upper;
+      TileCodec *codec = codecs.get(codecType);
+      if (TileCodec::isLossless(codecType)) {
+        quality     = 100;
+        subsampling = CHROMA_444;
+      } else {
+        quality     = std::max(1,std::min(100,quality));
+        codec->setQuality(quality);
+        codec->setChromaSubsampling(subsampling);
+      }
 
-      int numPixels = (end-begin).product();
-      this->numBytes = sizeof(CompressedTileHeader)+numPixels*sizeof(int);
-      this->data = new unsigned char[this->numBytes];
-      assert(this->data != NULL);
+      const size_t maxBytes
+        = sizeof(CompressedTileHeader)+codec->maxEncodedSize(tile.size());
+      reserve(maxBytes);
       CompressedTileHeader *header = (CompressedTileHeader *)this->data;
-      header->region.lower = begin;
-      header->region.upper = end;
-      header->eye          = tile.eye;
-
-#if TURBO_JPEG                       
-      unsigned char *jpegBuffer = header->payload; //NULL;
-      size_t jpegSize = numPixels*sizeof(int);
-      int rc = tjCompress2((tjhandle)compressor, (unsigned char *)tile.pixel,
-                           tile.size().x,tile.pitch*sizeof(int),tile.size().y,
-                           TJPF_BGRX, &jpegBuffer,&jpegSize,TJSAMP_444,JPEG_QUALITY,0);
-      this->numBytes = jpegSize + sizeof(*header);
-      // printf("compress %i: %li->%li bytes\n",rc,numPixels*sizeof(int),jpegSize);
-#else
-      uint32_t *out = (uint32_t *)header->payload;
-      const uint32_t *in = (const uint32_t *)tile.pixel;
-      for (uint32_t iy=begin.y;iy<end.y;iy++) {
-        for (uint32_t ix=begin.x;ix<end.x;ix++) {
-          *out++ = *in++;
-        }
-
-        in += (tile.pitch-(end.x-begin.x));
-      }
-#endif
+      header->region = tile.region;
+      header->eye    = tile.eye;
+      header->codec  = codecType;
+      header->frameID = 0;
+      header->quality     = quality;
+      header->subsampling = subsampling;
+
+      this->numBytes = sizeof(CompressedTileHeader)+codec->encode(header->payload,tile);
     }
     
-    void CompressedTile::decode(void *decompressor, PlainTile &tile)
+    void CompressedTile::decode(CodecSet &codecs, PlainTile &tile)
     {
       const CompressedTileHeader *header = (const CompressedTileHeader *)data;
       tile.region = header->region;
       tile.eye = header->eye;
-      vec2i size = tile.region.size();
       assert(tile.pixel != NULL);
-#if TURBO_JPEG                       
-      size_t jpegSize = this->numBytes-sizeof(*header);
-      int rc = tjDecompress2((tjhandle)decompressor, (unsigned char *)header->payload,
-                             this->numBytes-sizeof(*header),
-                             (unsigned char*)tile.pixel,
-                             size.x,tile.pitch*sizeof(int),size.y,
-                             TJPF_BGRX, 0);
-#else
-      uint32_t *out = tile.pixel;
-      uint32_t *in = (uint32_t *)(data+sizeof(CompressedTileHeader));
-      for (int iy=0;iy<size.y;iy++)
-        for (int ix=0;ix<size.x;ix++) {
-          *out++ = *in++;
-        }
-#endif
+      TileCodec *codec = codecs.get((CodecType)header->codec);
+      codec->decode(tile,header->payload,this->numBytes-sizeof(*header));
+    }
+
+    void CompressedTile::encodeStrided(const PlainTile &tile, int tag)
+    {
+      reserve(sizeof(CompressedTileHeader)+sizeof(int));
+      CompressedTileHeader *header = (CompressedTileHeader *)this->data;
+      header->region = tile.region;
+      header->eye    = tile.eye;
+      header->codec  = CODEC_STRIDED;
+      header->frameID = 0;
+      header->quality     = 100;
+      header->subsampling = CHROMA_444;
+      memcpy(header->payload,&tag,sizeof(tag));
+      this->numBytes = sizeof(CompressedTileHeader)+sizeof(tag);
+    }
+
+    int CompressedTile::rawBytesOfStrided() const
+    {
+      const CompressedTileHeader *header = (const CompressedTileHeader *)data;
+      assert(header && header->codec == CODEC_STRIDED);
+      return sizeof(CompressedTileHeader)+header->region.size().product()*sizeof(uint32_t);
+    }
+
+    MPI_Request CompressedTile::receiveStrided(const MPI::Group &group,
+                                               unsigned char *raw) const
+    {
+      const CompressedTileHeader *header = (const CompressedTileHeader *)data;
+      assert(header && header->codec == CODEC_STRIDED);
+      int tag;
+      memcpy(&tag,header->payload,sizeof(tag));
+      CompressedTileHeader *rawHeader = (CompressedTileHeader *)raw;
+      *rawHeader = *header;
+      rawHeader->codec = CODEC_RAW;
+
+      MPI_Request request;
+      MPI_CALL(Irecv(rawHeader->payload,header->region.size().product(),MPI_UINT32_T,
+                     fromRank,tag,group.comm,&request));
+      return request;
     }
 
     /*! get region that this tile corresponds to */
@@ -127,27 +156,53 @@ namespace ospray {
       assert(header);
       return header->region;
     }
+
+    /*! get the codec that this tile was encoded with */
+    CodecType CompressedTile::getCodec() const
+    {
+      const CompressedTileHeader *header = (const CompressedTileHeader *)data;
+      assert(header);
+      return (CodecType)header->codec;
+    }
+
+    /*! get the quality that this tile was encoded with */
+    int CompressedTile::getQuality() const
+    {
+      const CompressedTileHeader *header = (const CompressedTileHeader *)data;
+      assert(header);
+      return header->quality;
+    }
+
+    /*! get the chroma subsampling that this tile was encoded with */
+    ChromaSubsampling CompressedTile::getSubsampling() const
+    {
+      const CompressedTileHeader *header = (const CompressedTileHeader *)data;
+      assert(header);
+      return (ChromaSubsampling)header->subsampling;
+    }
+
+    /*! get the eye that this tile belongs to */
+    int CompressedTile::getEye() const
+    {
+      const CompressedTileHeader *header = (const CompressedTileHeader *)data;
+      assert(header);
+      return header->eye;
+    }
     
-    /*! send the tile to the given rank in the given group */
-    void CompressedTile::sendTo(const MPI::Group &group, const int rank) const
+    /*! get the frame that this tile belongs to */
+    int CompressedTile::getFrameID() const
     {
-      static std::atomic<int> tileID;
-      int myTileID = tileID++;
-      MPI_CALL(Send(data,numBytes,MPI_BYTE,rank,myTileID,group.comm));
+      const CompressedTileHeader *header = (const CompressedTileHeader *)data;
+      assert(header);
+      return header->frameID;
     }
 
-    /*! receive one tile from the outside communicator */
-    void CompressedTile::receiveOne(const MPI::Group &outside)
+    /*! set the frame that this (already encoded) tile belongs to */
+    void CompressedTile::setFrameID(int frameID)
     {
-      // printf("receiveone from outside %i/%i\n",outside.rank,outside.size);
-      MPI_Status status;
-      MPI_CALL(Probe(MPI_ANY_SOURCE,MPI_ANY_TAG,outside.comm,&status));
-      fromRank = status.MPI_SOURCE;
-      MPI_CALL(Get_count(&status,MPI_BYTE,&numBytes));        
-      // printf("incoming from %i, %i bytes\n",status.MPI_SOURCE,numBytes);
-      data = new unsigned char[numBytes];
-      MPI_CALL(Recv(data,numBytes,MPI_BYTE,status.MPI_SOURCE,status.MPI_TAG,
-                    outside.comm,&status));
+      CompressedTileHeader *header = (CompressedTileHeader *)data;
+      assert(header);
+      header->frameID = frameID;
     }
 
   } // ::ospray::dw
@@ -23,6 +23,8 @@ SOFTWARE.
 #pragma once 
 
 #include "MPI.h"
+#include "TileCodec.h"
+#include "BufferPool.h"
 
 namespace ospray {
   namespace dw {
@@ -34,11 +36,26 @@ namespace ospray {
     {
       PlainTile(const vec2i &tileSize)
         : pitch(tileSize.x),
-          pixel(new uint32_t [tileSize.x*tileSize.y])
+          pixel((uint32_t *)BufferPool::allocate(tileSize.product()*sizeof(uint32_t))),
+          ownsPixel(true)
+      {}
+
+      /*! a tile that lives in someone else's pixel buffer (eg, a
+          window into a frame buffer), 'pitch' pixels wide; the tile
+          does not take ownership of that buffer */
+      PlainTile(uint32_t *pixel, int pitch, int eye = 0)
+        : pitch(pitch),
+          eye(eye),
+          pixel(pixel),
+          ownsPixel(false)
+      {}
+      /*! read-only window into someone else's pixel buffer */
+      PlainTile(const uint32_t *pixel, int pitch, int eye = 0)
+        : PlainTile((uint32_t *)pixel,pitch,eye)
       {}
 
       ~PlainTile()
-      { delete[] pixel; }
+      { if (ownsPixel) BufferPool::release(pixel); }
 
       inline vec2i size() const { return region.size(); }
 
@@ -50,35 +67,81 @@ namespace ospray {
       int       eye   { 0 };
       /*! pointer to buffer of pixels; this buffer is 'pitch' int-sized pixels wide */
       uint32_t *pixel { nullptr };
+      /*! whether we allocated (and thus have to release) pixel[] */
+      bool      ownsPixel { false };
     };
 
-    /*! encoded representation of a tile - eventually to use true
-        compression; for now we just pack all pixels (and header) into
-        a single linear array of ints */
+    /*! encoded representation of a tile: a small header (region, eye,
+        codec, and frame ID), followed by the codec's encoded pixel
+        data, all in one linear array of bytes */
     struct CompressedTile {
       CompressedTile();
+      /*! a tile that lives in someone else's memory (eg, inside a
+          TileBatch); the tile does not take ownership of 'data' */
+      CompressedTile(unsigned char *data, int numBytes, int fromRank);
       ~CompressedTile();
 
       unsigned char *data;
       int fromRank;
       int numBytes;
+      /*! whether data[] came from the BufferPool, and is ours to
+          release */
+      bool ownsData;
 
       /*! get region that this tile corresponds to */
       box2i getRegion() const;
-
-      /*! send the tile to the given rank in the given group */
-      void sendTo(const MPI::Group &outside, const int targetRank) const;
-
-      /*! receive one tile from the outside communicator */
-      void receiveOne(const MPI::Group &outside); 
-      void encode(void *compressor, const PlainTile &tile);
-      void decode(void *decompressor, PlainTile &tile);
-
-      static void *createCompressor();
-      static void *createDecompressor();
-      static void freeCompressor(void *);
-      static void freeDecompressor(void *);
+      /*! get the codec that this tile was encoded with */
+      CodecType getCodec() const;
+      /*! @{ get the quality (1..100) and chroma subsampling that this
+          tile was encoded with; 100 and CHROMA_444 if its codec is
+          lossless */
+      int getQuality() const;
+      ChromaSubsampling getSubsampling() const;
+      /*! @} */
+      /*! get the eye that this tile belongs to */
+      int getEye() const;
+      /*! get the frame that this tile belongs to */
+      int getFrameID() const;
+      /*! set the frame that this (already encoded) tile belongs to;
+          encode() sets it to 0 */
+      void setFrameID(int frameID);
+
+      /*! make sure data[] has room for at least numBytes bytes;
+          does not preserve its content */
+      void reserve(size_t numBytes);
+
+      /*! encode given tile with given codec (taken from the given
+          thread-local codec set); lossy codecs use the given quality
+          and chroma subsampling, which the tile remembers */
+      void encode(CodecSet &codecs, CodecType codec, const PlainTile &tile,
+                  int quality=100, ChromaSubsampling subsampling=CHROMA_444);
+      /*! decode this tile into given plain tile, using whatever codec
+          is specified in this tile's header */
+      void decode(CodecSet &codecs, PlainTile &tile);
+
+      /*! @{ 'strided' tiles (see CODEC_STRIDED): make this the tile
+          for the given plain tile, whose pixels go as a message of
+          their own, with the given tag. The caller sends those
+          (densely packed, see packPixels()) to the same rank as the
+          tile itself, both any which way */
+      void encodeStrided(const PlainTile &tile, int tag);
+      /*! number of bytes of the raw tile that receiveStrided() makes
+          of this (strided) tile */
+      int rawBytesOfStrided() const;
+      /*! make 'raw' (which needs room for rawBytesOfStrided() bytes)
+          a raw tile with this (strided) tile's region, eye, and
+          frame, and post the receive of its pixels, from the rank
+          this tile came from, straight into it; 'raw' must stay put
+          until the returned request has completed */
+      MPI_Request receiveStrided(const MPI::Group &group, unsigned char *raw) const;
+      /*! @} */
     };
+
+    /*! tags for the pixel messages of strided tiles: senders cycle
+        through this range, and each tile carries its message's tag,
+        so pixel messages from the same sender can't get mixed up */
+#define STRIDED_PIXELS_TAG      16
+#define STRIDED_PIXELS_NUM_TAGS 16384
     
   } // ::ospray::dw
 } // ::ospray
@@ -0,0 +1,110 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+
+namespace ospray {
+  namespace dw {
+
+    /*! a bounded, lock-free multi-producer/multi-consumer queue (the
+        classic ring of sequence-numbered cells): push() and pop()
+        never block, and only fail if the queue is full or empty,
+        respectively. Meant for handing around pointers between
+        pipeline stages, so 'T' should be cheap to copy */
+    template<typename T>
+    struct ConcurrentQueue {
+      /*! 'capacity' gets rounded up to a power of two */
+      ConcurrentQueue(size_t capacity)
+      {
+        size_t size = 2;
+        while (size < capacity) size *= 2;
+        mask = size-1;
+        cells.reset(new Cell[size]);
+        for (size_t i=0;i<size;i++)
+          cells[i].sequence.store(i,std::memory_order_relaxed);
+        head.store(0,std::memory_order_relaxed);
+        tail.store(0,std::memory_order_relaxed);
+      }
+
+      /*! append 'item'; returns false (and doesn't append it) if the
+          queue is full */
+      bool push(const T &item)
+      {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        while (1) {
+          Cell &cell = cells[pos & mask];
+          const size_t seq = cell.sequence.load(std::memory_order_acquire);
+          const ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)pos;
+          if (diff == 0) {
+            if (tail.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed)) {
+              cell.item = item;
+              cell.sequence.store(pos+1,std::memory_order_release);
+              return true;
+            }
+          } else if (diff < 0)
+            return false;
+          else
+            pos = tail.load(std::memory_order_relaxed);
+        }
+      }
+
+      /*! take the oldest item; returns false if the queue is empty */
+      bool pop(T &item)
+      {
+        size_t pos = head.load(std::memory_order_relaxed);
+        while (1) {
+          Cell &cell = cells[pos & mask];
+          const size_t seq = cell.sequence.load(std::memory_order_acquire);
+          const ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)(pos+1);
+          if (diff == 0) {
+            if (head.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed)) {
+              item = cell.item;
+              cell.sequence.store(pos+mask+1,std::memory_order_release);
+              return true;
+            }
+          } else if (diff < 0)
+            return false;
+          else
+            pos = head.load(std::memory_order_relaxed);
+        }
+      }
+
+    private:
+      struct Cell {
+        std::atomic<size_t> sequence;
+        T item;
+      };
+      std::unique_ptr<Cell[]> cells;
+      size_t mask;
+      /*! on separate cache lines, so producers and consumers don't
+          keep stealing each other's line */
+      alignas(64) std::atomic<size_t> tail;
+      alignas(64) std::atomic<size_t> head;
+    };
+
+  } // ::ospray::dw
+} // ::ospray
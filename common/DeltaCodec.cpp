@@ -0,0 +1,176 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*! codec for inter-frame residuals: the 'pixels' of a delta tile are
+    the per-channel differences (mod 256) to the same region in the
+    previous frame, see subtractPixels()/addPixels(). Those are mostly
+    small, so we map every channel to an unsigned value (zig-zag) and
+    entropy code it with adaptive Rice codes: blocks of 64 channel
+    values share one Rice parameter (or get flagged as all-zero) */
+
+#include "TileCodec.h"
+#include "CompressedTile.h"
+
+namespace ospray {
+  namespace dw {
+
+#define DELTA_BLOCK_SIZE  64
+#define DELTA_ZERO_BLOCK  8
+#define DELTA_MAX_UNARY   15
+
+    /*! map a (signed) byte difference to 0,1,2,... for -0,-1,+1,-2,... */
+    inline uint32_t zigZag(unsigned char v)
+    { const int s = (signed char)v; return s >= 0 ? 2*s : -2*s-1; }
+
+    inline unsigned char unZigZag(uint32_t z)
+    { return (unsigned char)((z & 1) ? -int((z+1)>>1) : int(z>>1)); }
+
+    struct BitWriter {
+      BitWriter(unsigned char *out) : out(out), begin(out) {}
+      inline void put(uint32_t bits, int numBits)
+      {
+        acc |= uint64_t(bits) << numAccBits;
+        numAccBits += numBits;
+        while (numAccBits >= 8) {
+          *out++ = (unsigned char)acc;
+          acc >>= 8;
+          numAccBits -= 8;
+        }
+      }
+      inline size_t finish()
+      {
+        if (numAccBits > 0) *out++ = (unsigned char)acc;
+        return out - begin;
+      }
+      unsigned char *out, *begin;
+      uint64_t acc { 0 };
+      int numAccBits { 0 };
+    };
+
+    struct BitReader {
+      BitReader(const unsigned char *in, size_t numBytes) : in(in), end(in+numBytes) {}
+      inline uint32_t get(int numBits)
+      {
+        while (numAccBits < numBits) {
+          if (in >= end) throw std::runtime_error("delta codec: corrupt input");
+          acc |= uint64_t(*in++) << numAccBits;
+          numAccBits += 8;
+        }
+        const uint32_t bits = uint32_t(acc & ((1ULL << numBits)-1));
+        acc >>= numBits;
+        numAccBits -= numBits;
+        return bits;
+      }
+      const unsigned char *in, *end;
+      uint64_t acc { 0 };
+      int numAccBits { 0 };
+    };
+
+    struct DeltaCodec : public TileCodec {
+      /*! worst case is an escape (unary prefix plus 8 raw bits) for every
+          channel, plus one block header per DELTA_BLOCK_SIZE channels */
+      virtual size_t maxEncodedSize(const vec2i &size) const override
+      {
+        const size_t numValues = size.product()*sizeof(uint32_t);
+        return (numValues*(DELTA_MAX_UNARY+8) + (numValues/DELTA_BLOCK_SIZE+1)*4)/8 + 8;
+      }
+
+      virtual size_t encode(unsigned char *out, const PlainTile &tile) override
+      {
+        const vec2i size = tile.size();
+        const size_t numValues = size.product()*sizeof(uint32_t);
+        values.resize(numValues);
+        for (int iy=0;iy<size.y;iy++) {
+          const unsigned char *row = (const unsigned char *)(tile.pixel + iy*tile.pitch);
+          for (int i=0;i<size.x*4;i++)
+            values[iy*size.x*4+i] = zigZag(row[i]);
+        }
+
+        BitWriter bits(out);
+        for (size_t begin=0;begin<numValues;begin+=DELTA_BLOCK_SIZE) {
+          const size_t end = std::min(numValues,begin+DELTA_BLOCK_SIZE);
+          uint32_t sum = 0;
+          for (size_t i=begin;i<end;i++)
+            sum += values[i];
+          if (sum == 0) {
+            bits.put(DELTA_ZERO_BLOCK,4);
+            continue;
+          }
+          // rice parameter ~ log2 of mean value
+          const uint32_t count = uint32_t(end-begin);
+          int k = 0;
+          while (k < 7 && (count << (k+1)) <= sum) ++k;
+          bits.put(k,4);
+          for (size_t i=begin;i<end;i++) {
+            const uint32_t q = values[i] >> k;
+            if (q < DELTA_MAX_UNARY) {
+              bits.put((1U<<q)-1,q+1);
+              if (k) bits.put(values[i] & ((1U<<k)-1),k);
+            } else {
+              bits.put((1U<<DELTA_MAX_UNARY)-1,DELTA_MAX_UNARY);
+              bits.put(values[i],8);
+            }
+          }
+        }
+        return bits.finish();
+      }
+
+      virtual void decode(PlainTile &tile, const unsigned char *in, size_t numBytes) override
+      {
+        const vec2i size = tile.size();
+        const size_t numValues = size.product()*sizeof(uint32_t);
+        values.resize(numValues);
+
+        BitReader bits(in,numBytes);
+        for (size_t begin=0;begin<numValues;begin+=DELTA_BLOCK_SIZE) {
+          const size_t end = std::min(numValues,begin+DELTA_BLOCK_SIZE);
+          const int k = bits.get(4);
+          if (k == DELTA_ZERO_BLOCK) {
+            for (size_t i=begin;i<end;i++) values[i] = 0;
+            continue;
+          }
+          if (k > 7) throw std::runtime_error("delta codec: corrupt input");
+          for (size_t i=begin;i<end;i++) {
+            uint32_t q = 0;
+            while (q < DELTA_MAX_UNARY && bits.get(1)) ++q;
+            if (q < DELTA_MAX_UNARY)
+              values[i] = (q << k) | (k ? bits.get(k) : 0);
+            else
+              values[i] = bits.get(8);
+          }
+        }
+
+        for (int iy=0;iy<size.y;iy++) {
+          unsigned char *row = (unsigned char *)(tile.pixel + iy*tile.pitch);
+          for (int i=0;i<size.x*4;i++)
+            row[i] = unZigZag(values[iy*size.x*4+i]);
+        }
+      }
+
+      /*! zig-zag'ed channel values of the current tile */
+      std::vector<uint32_t> values;
+    };
+
+    TileCodec *createDeltaCodec() { return new DeltaCodec; }
+
+  } // ::ospray::dw
+} // ::ospray
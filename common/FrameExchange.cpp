@@ -0,0 +1,147 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "FrameExchange.h"
+#include <climits>
+
+namespace ospray {
+  namespace dw {
+
+    FrameExchange::FrameExchange(const MPI::Group &clientsAndDisplays)
+      : group(clientsAndDisplays.dup()),
+        queue(group.size),
+        numBytes(group.size),
+        offset(group.size),
+        noBytes(group.size,0)
+    {
+      assert(group.isInter);
+      for (auto &q : queue)
+        q = new Queue;
+    }
+
+    FrameExchange::~FrameExchange()
+    {
+      for (auto q : queue)
+        delete q;
+      for (auto x : posted)
+        delete x;
+      for (auto x : unused)
+        delete x;
+      // no MPI_CALL() here - we must not throw from a destructor
+      MPI_Comm_free(&group.comm);
+    }
+
+    void FrameExchange::add(const CompressedTile &tile, int rank)
+    {
+      Queue &q = *queue[rank];
+      std::lock_guard<std::mutex> lock(q.mutex);
+      q.batch.append(tile);
+    }
+
+    void FrameExchange::post()
+    {
+      Exchange *x;
+      if (unused.empty())
+        x = new Exchange;
+      else {
+        x = unused.back();
+        unused.pop_back();
+      }
+      x->numBytes.resize(group.size);
+      x->offset.resize(group.size);
+      x->numRemoteBytes.resize(group.size);
+
+      /* the displays' tiles go out of one buffer, one display's
+         after the other's */
+      size_t totalBytes = 0;
+      for (auto q : queue)
+        totalBytes += q->batch.numBytes;
+      if (totalBytes > INT_MAX)
+        throw std::runtime_error("frame too large for a collective tile exchange");
+      TileBatch &tiles = x->tiles;
+      tiles.clear();
+      tiles.reserve(totalBytes);
+      for (int rank=0;rank<group.size;rank++) {
+        TileBatch &batch = queue[rank]->batch;
+        if (batch.numBytes)
+          memcpy(tiles.data+tiles.numBytes,batch.data,batch.numBytes);
+        x->offset[rank]   = tiles.numBytes;
+        x->numBytes[rank] = batch.numBytes;
+        tiles.numBytes += batch.numBytes;
+        tiles.numTiles += batch.numTiles;
+        batch.clear();
+      }
+
+      /* first tell each display how much to expect, then send it;
+         the displays don't send anything */
+      MPI_CALL(Ialltoall(x->numBytes.data(),1,MPI_INT,
+                         x->numRemoteBytes.data(),1,MPI_INT,
+                         group.comm,&x->request[0]));
+      MPI_CALL(Ialltoallv(tiles.data,x->numBytes.data(),x->offset.data(),MPI_BYTE,
+                          noBytes.data(),noBytes.data(),noBytes.data(),MPI_BYTE,
+                          group.comm,&x->request[1]));
+      posted.push_back(x);
+    }
+
+    void FrameExchange::wait()
+    {
+      if (posted.empty())
+        return;
+      Exchange *x = posted.front();
+      MPI_CALL(Waitall(2,x->request,MPI_STATUSES_IGNORE));
+      posted.pop_front();
+      unused.push_back(x);
+    }
+
+    void FrameExchange::receive(TileBatch &frame)
+    {
+      /* the clients' side of the exchange is non-blocking, which a
+         blocking collective wouldn't match, so this has to be the
+         non-blocking kind, too */
+      MPI_Request request;
+      MPI_CALL(Ialltoall(noBytes.data(),1,MPI_INT,
+                         numBytes.data(),1,MPI_INT,
+                         group.comm,&request));
+      MPI_CALL(Wait(&request,MPI_STATUS_IGNORE));
+
+      size_t totalBytes = 0;
+      for (int rank=0;rank<group.size;rank++) {
+        offset[rank] = totalBytes;
+        totalBytes += numBytes[rank];
+        if (totalBytes > INT_MAX)
+          throw std::runtime_error("frame too large for a collective tile exchange");
+      }
+      frame.clear();
+      frame.reserve(totalBytes);
+      MPI_CALL(Ialltoallv(noBytes.data(),noBytes.data(),noBytes.data(),MPI_BYTE,
+                          frame.data,numBytes.data(),offset.data(),MPI_BYTE,
+                          group.comm,&request));
+      MPI_CALL(Wait(&request,MPI_STATUS_IGNORE));
+      /* each client's tiles are a regular batch, so all of them
+         back to back are one, too */
+      frame.numBytes = totalBytes;
+      frame.numTiles = -1; // unknown until we iterate
+      frame.fromRank = -1;
+    }
+
+  } // ::ospray::dw
+} // ::ospray
@@ -0,0 +1,97 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "MPI.h"
+#include "TileBatch.h"
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace ospray {
+  namespace dw {
+
+    /*! sends all tiles of a frame from the clients to the displays
+        in one collective exchange (an all-to-all over the
+        clients<->displays intercomm), instead of as individual tile
+        batches that the displays have to probe for. Clients collect
+        each display's tiles for the current frame, and post() them
+        once the frame is done; displays receive() each frame's tiles
+        from all clients at once.
+
+        Exchanges run on a communicator of their own, so they don't
+        get in the way of the per-frame barriers; both sides have to
+        take part in every frame's exchange, in order */
+    struct FrameExchange {
+      /*! collective over both groups of the given clients<->displays
+          intercomm */
+      FrameExchange(const MPI::Group &clientsAndDisplays);
+      ~FrameExchange();
+
+      /*! (clients) queue the given tile for the display with the
+          given rank, for the current frame. Thread-safe */
+      void add(const CompressedTile &tile, int rank);
+      /*! (clients) start sending the current frame's tiles; the
+          frame's tiles may still be on their way when this
+          returns. Not thread-safe with add() */
+      void post();
+      /*! (clients) wait until the oldest post()ed frame's tiles are
+          all on their displays */
+      void wait();
+
+      /*! (displays) receive the next frame's tiles from all clients,
+          as one batch (which isn't from any particular rank) */
+      void receive(TileBatch &frame);
+
+    private:
+      /*! a frame's tiles for one display rank */
+      struct Queue {
+        std::mutex mutex;
+        TileBatch  batch;
+      };
+      /*! (clients) a frame's tiles for all displays, in one buffer,
+          and what it takes to send them */
+      struct Exchange {
+        TileBatch        tiles;
+        std::vector<int> numBytes;
+        std::vector<int> offset;
+        /*! what we get from the displays (which is nothing) */
+        std::vector<int> numRemoteBytes;
+        MPI_Request      request[2];
+      };
+
+      MPI::Group group;
+      std::vector<Queue *>  queue;
+      /*! (clients) exchanges that were post()ed, but not waited
+          for yet, oldest first; and ones that can be re-used */
+      std::deque<Exchange *> posted;
+      std::vector<Exchange *> unused;
+      /*! (displays) how many bytes each client sends us, and where
+          those go in the received frame */
+      std::vector<int> numBytes;
+      std::vector<int> offset;
+      std::vector<int> noBytes;
+    };
+
+  } // ::ospray::dw
+} // ::ospray
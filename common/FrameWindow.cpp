@@ -0,0 +1,125 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#include "FrameWindow.h"
+#include "BufferPool.h"
+
+namespace ospray {
+  namespace dw {
+
+    FrameWindow::FrameWindow(const MPI::Group &clientsAndDisplays,
+                             bool isDisplay,
+                             const WallConfig &wallConfig,
+                             int numSlots)
+      : numSlots(numSlots),
+        wallConfig(wallConfig),
+        numEyes(wallConfig.stereo ? 2 : 1),
+        comm(MPI_COMM_NULL),
+        win(MPI_WIN_NULL),
+        pixels(NULL)
+    {
+      assert(clientsAndDisplays.isInter);
+      MPI_CALL(Intercomm_merge(clientsAndDisplays.comm,!isDisplay,&comm));
+      const MPI_Aint numBytes
+        = isDisplay
+        ? numSlots*wallConfig.displayPixelCount()*sizeof(uint32_t)
+        : 0;
+      MPI_CALL(Win_allocate(numBytes,sizeof(uint32_t),MPI_INFO_NULL,comm,
+                            &pixels,&win));
+      if (!isDisplay)
+        pixels = NULL;
+      /* one epoch on everybody, for as long as the window lives; the
+         displays only need theirs for sync() */
+      MPI_CALL(Win_lock_all(MPI_MODE_NOCHECK,win));
+    }
+
+    FrameWindow::~FrameWindow()
+    {
+      // no MPI_CALL() here - we must not throw from a destructor
+      MPI_Win_unlock_all(win);
+      MPI_Win_free(&win);
+      MPI_Comm_free(&comm);
+      for (auto buffer : putBuffers)
+        BufferPool::release(buffer);
+    }
+
+    size_t FrameWindow::slotOffset(int frameID, int eye) const
+    {
+      const int slot = ((frameID % numSlots) + numSlots) % numSlots;
+      return (slot*numEyes + eye)*size_t(wallConfig.pixelsPerDisplay.product());
+    }
+
+    void FrameWindow::put(const PlainTile &tile, const box2i &visible,
+                          int rank, int frameID)
+    {
+      const vec2i size = visible.size();
+      const box2i displayRegion = wallConfig.regionOfRank(rank);
+      const int tileOfs
+        = (visible.lower.x-tile.region.lower.x)
+        + tile.pitch * (visible.lower.y-tile.region.lower.y);
+      const MPI_Aint targetOfs
+        = slotOffset(frameID,tile.eye)
+        + (visible.lower.x-displayRegion.lower.x)
+        + wallConfig.pixelsPerDisplay.x * (visible.lower.y-displayRegion.lower.y);
+
+      /* the put only completes in flush(), but the caller may re-use
+         the tile as soon as we return, so we put from a copy (which
+         is cheap compared to waiting for the network, per tile) */
+      uint32_t *pixels
+        = (uint32_t *)BufferPool::allocate(size.product()*sizeof(uint32_t));
+      for (int iy=0;iy<size.y;iy++)
+        memcpy(pixels+iy*size.x,tile.pixel+tileOfs+iy*tile.pitch,size.x*sizeof(uint32_t));
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        putBuffers.push_back(pixels);
+      }
+
+      /* all rows in one put, strided by the display's pitch */
+      MPI_CALL(Put(pixels,size.product(),MPI_UINT32_T,
+                   rank,targetOfs,1,MPI::pixelRows(size,wallConfig.pixelsPerDisplay.x),
+                   win));
+    }
+
+    void FrameWindow::flush()
+    {
+      MPI_CALL(Win_flush_all(win));
+      std::lock_guard<std::mutex> lock(mutex);
+      for (auto buffer : putBuffers)
+        BufferPool::release(buffer);
+      putBuffers.clear();
+    }
+
+    void FrameWindow::sync()
+    {
+      MPI_CALL(Win_sync(win));
+    }
+
+    const uint32_t *FrameWindow::pixelsOf(int frameID, int eye) const
+    {
+      assert(pixels);
+      return pixels+slotOffset(frameID,eye);
+    }
+
+  } // ::ospray::dw
+} // ::ospray
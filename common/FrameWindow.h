@@ -0,0 +1,96 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#pragma once
+
+#include "MPI.h"
+#include "WallConfig.h"
+#include "CompressedTile.h"
+#include <mutex>
+#include <vector>
+
+namespace ospray {
+  namespace dw {
+
+    /*! the displays' receive frame buffers, exposed as one MPI RMA
+        window, so clients can write raw pixels straight into them
+        (MPI_Put) instead of sending tiles. Each display exposes
+        'numSlots' frames (left and, in stereo, right eye), one per
+        frame in flight, indexed by frameID % numSlots; each client
+        keeps a passive-target epoch open on all displays for as long
+        as the window exists.
+
+        A frame's pixels are only known to be in place once all
+        clients have flush()ed after writing them, and (in that
+        order) entered a barrier with the displays; after that
+        barrier, displays have to sync() before reading them */
+    struct FrameWindow {
+      /*! collective over both groups of the given clients<->displays
+          intercomm; 'isDisplay' says which side we're on. Clients
+          don't expose any memory themselves */
+      FrameWindow(const MPI::Group &clientsAndDisplays,
+                  bool isDisplay,
+                  const WallConfig &wallConfig,
+                  int numSlots);
+      ~FrameWindow();
+
+      /*! (clients) write the given part of the tile (which has to be
+          on the display with the given rank) into that display's
+          buffer for the given frame; doesn't wait for the network
+          (the pixels go from a copy, which lives until the next
+          flush()), so the tile's memory may be re-used right away.
+          Thread-safe */
+      void put(const PlainTile &tile, const box2i &visible, int rank, int frameID);
+      /*! (clients) wait until all puts so far have completed on
+          their displays, and free their copies of the pixels */
+      void flush();
+
+      /*! (displays) make whatever clients put into our buffers (and
+          flush()ed) visible to this process */
+      void sync();
+      /*! (displays) our buffer for the given frame and eye; the
+          display's pixels, pixelsPerDisplay.x wide */
+      const uint32_t *pixelsOf(int frameID, int eye) const;
+
+      const int numSlots;
+    private:
+      /*! offset (in pixels) of the given frame's and eye's buffer */
+      size_t slotOffset(int frameID, int eye) const;
+
+      const WallConfig wallConfig;
+      const int        numEyes;
+      /*! clients and displays in one intracomm (displays first, in
+          the same order as in the intercomm), since RMA windows can't
+          live on intercomms */
+      MPI_Comm  comm;
+      MPI_Win   win;
+      /*! our part of the window; NULL on clients */
+      uint32_t *pixels;
+      /*! (clients) the copies put() sends from, until flush() */
+      std::vector<void *> putBuffers;
+      std::mutex          mutex;
+    };
+
+  } // ::ospray::dw
+} // ::ospray
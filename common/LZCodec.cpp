@@ -0,0 +1,219 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*! a fast, lossless byte codec that writes the LZ4 block format
+    (sequences of literals plus 16-bit back-references); it does not
+    compress as well as a real entropy coder, but is cheap enough to
+    run on every tile of every frame on the render nodes */
+
+#include "TileCodec.h"
+#include "CompressedTile.h"
+
+namespace ospray {
+  namespace dw {
+
+#define LZ_MIN_MATCH     4
+#define LZ_LAST_LITERALS 5
+#define LZ_MF_LIMIT      12
+#define LZ_MAX_OFFSET    65535
+#define LZ_HASH_LOG      12
+
+    inline uint32_t lzRead32(const unsigned char *p)
+    { uint32_t v; memcpy(&v,p,sizeof(v)); return v; }
+
+    inline uint32_t lzHash(uint32_t v)
+    { return (v * 2654435761U) >> (32-LZ_HASH_LOG); }
+
+    /*! write a length value of the form '15 + 255 + 255 + ... + rest' */
+    inline unsigned char *lzWriteLength(unsigned char *op, size_t len)
+    {
+      while (len >= 255) { *op++ = 255; len -= 255; }
+      *op++ = (unsigned char)len;
+      return op;
+    }
+
+    /*! upper bound for compressed size of 'numBytes' input bytes */
+    size_t lzMaxCompressedSize(size_t numBytes)
+    { return numBytes + numBytes/255 + 16; }
+
+    /*! compress 'numBytes' bytes from 'src' into 'dst'; 'dst' has to
+        have at least lzMaxCompressedSize(numBytes) bytes. returns
+        number of bytes written */
+    size_t lzCompress(unsigned char *dst, const unsigned char *src, size_t numBytes)
+    {
+      const unsigned char *ip     = src;
+      const unsigned char *anchor = src;
+      const unsigned char *iend   = src + numBytes;
+      unsigned char       *op     = dst;
+
+      if (numBytes > LZ_MF_LIMIT) {
+        const unsigned char *mfLimit    = iend - LZ_MF_LIMIT;
+        const unsigned char *matchLimit = iend - LZ_LAST_LITERALS;
+        int hashTable[1<<LZ_HASH_LOG];
+        for (int i=0;i<(1<<LZ_HASH_LOG);i++) hashTable[i] = -1;
+
+        while (ip < mfLimit) {
+          const uint32_t seq = lzRead32(ip);
+          const uint32_t h   = lzHash(seq);
+          const int ref = hashTable[h];
+          hashTable[h] = int(ip-src);
+          if (ref < 0 || (ip-(src+ref)) > LZ_MAX_OFFSET || lzRead32(src+ref) != seq) {
+            ++ip;
+            continue;
+          }
+
+          const unsigned char *match = src+ref;
+          // extend match backwards into pending literals
+          while (ip > anchor && match > src && ip[-1] == match[-1]) { --ip; --match; }
+
+          // ... and forward as far as possible
+          const unsigned char *mEnd = ip + LZ_MIN_MATCH;
+          const unsigned char *mRef = match + LZ_MIN_MATCH;
+          while (mEnd < matchLimit && *mEnd == *mRef) { ++mEnd; ++mRef; }
+
+          const size_t litLen   = ip - anchor;
+          const size_t matchLen = mEnd - ip - LZ_MIN_MATCH;
+          const size_t offset   = ip - match;
+
+          unsigned char *token = op++;
+          *token = (unsigned char)((litLen >= 15 ? 15 : litLen) << 4);
+          if (litLen >= 15) op = lzWriteLength(op,litLen-15);
+          memcpy(op,anchor,litLen);
+          op += litLen;
+          *op++ = (unsigned char)(offset & 0xff);
+          *op++ = (unsigned char)(offset >> 8);
+          *token |= (unsigned char)(matchLen >= 15 ? 15 : matchLen);
+          if (matchLen >= 15) op = lzWriteLength(op,matchLen-15);
+
+          ip = anchor = mEnd;
+        }
+      }
+
+      // last sequence: literals only
+      const size_t litLen = iend - anchor;
+      *op++ = (unsigned char)((litLen >= 15 ? 15 : litLen) << 4);
+      if (litLen >= 15) op = lzWriteLength(op,litLen-15);
+      memcpy(op,anchor,litLen);
+      op += litLen;
+      return op - dst;
+    }
+
+    /*! decompress 'numBytes' compressed bytes from 'src' into
+        exactly 'outBytes' bytes at 'dst'; throws a std::runtime_error
+        if the input is malformed */
+    void lzDecompress(unsigned char *dst, size_t outBytes,
+                      const unsigned char *src, size_t numBytes)
+    {
+      const unsigned char *ip   = src;
+      const unsigned char *iend = src + numBytes;
+      unsigned char       *op   = dst;
+      unsigned char       *oend = dst + outBytes;
+
+      while (ip < iend) {
+        const unsigned char token = *ip++;
+
+        size_t litLen = token >> 4;
+        if (litLen == 15) {
+          unsigned char b;
+          do {
+            if (ip >= iend) throw std::runtime_error("lz codec: corrupt input");
+            b = *ip++;
+            litLen += b;
+          } while (b == 255);
+        }
+        if (litLen > size_t(iend-ip) || litLen > size_t(oend-op))
+          throw std::runtime_error("lz codec: corrupt input");
+        memcpy(op,ip,litLen);
+        ip += litLen;
+        op += litLen;
+
+        if (ip == iend)
+          // last sequence has no match
+          break;
+
+        if (iend-ip < 2) throw std::runtime_error("lz codec: corrupt input");
+        const size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > size_t(op-dst))
+          throw std::runtime_error("lz codec: corrupt input");
+
+        size_t matchLen = token & 15;
+        if (matchLen == 15) {
+          unsigned char b;
+          do {
+            if (ip >= iend) throw std::runtime_error("lz codec: corrupt input");
+            b = *ip++;
+            matchLen += b;
+          } while (b == 255);
+        }
+        matchLen += LZ_MIN_MATCH;
+        if (matchLen > size_t(oend-op))
+          throw std::runtime_error("lz codec: corrupt input");
+
+        // byte by byte, since source and destination may overlap
+        const unsigned char *match = op - offset;
+        for (size_t i=0;i<matchLen;i++)
+          op[i] = match[i];
+        op += matchLen;
+      }
+      if (op != oend)
+        throw std::runtime_error("lz codec: tile size mismatch");
+    }
+
+    struct LZCodec : public TileCodec {
+      virtual size_t maxEncodedSize(const vec2i &size) const override
+      { return lzMaxCompressedSize(size.product()*sizeof(uint32_t)); }
+
+      virtual size_t encode(unsigned char *out, const PlainTile &tile) override
+      {
+        const vec2i size = tile.size();
+        const uint32_t *in = tile.pixel;
+        if (tile.pitch != size.x) {
+          scratch.resize(size.product());
+          packPixels(scratch.data(),tile);
+          in = scratch.data();
+        }
+        return lzCompress(out,(const unsigned char *)in,size.product()*sizeof(uint32_t));
+      }
+
+      virtual void decode(PlainTile &tile, const unsigned char *in, size_t numBytes) override
+      {
+        const vec2i size = tile.size();
+        if (tile.pitch == size.x) {
+          lzDecompress((unsigned char *)tile.pixel,size.product()*sizeof(uint32_t),
+                       in,numBytes);
+        } else {
+          scratch.resize(size.product());
+          lzDecompress((unsigned char *)scratch.data(),size.product()*sizeof(uint32_t),
+                       in,numBytes);
+          unpackPixels(tile,scratch.data());
+        }
+      }
+
+      /*! for tiles whose pitch doesn't match their width */
+      std::vector<uint32_t> scratch;
+    };
+
+    TileCodec *createLZCodec() { return new LZCodec; }
+
+  } // ::ospray::dw
+} // ::ospray
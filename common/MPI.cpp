@@ -21,6 +21,9 @@ SOFTWARE.
 */
 
 #include "MPI.h"
+#include <map>
+#include <mutex>
+#include <tuple>
 
 namespace ospray {
   namespace dw {
@@ -40,6 +43,22 @@ namespace ospray {
       }
     }
 
+    MPI_Datatype MPI::pixelRows(const vec2i &size, int pitch)
+    {
+      static std::mutex mutex;
+      static std::map<std::tuple<int,int,int>,MPI_Datatype> types;
+      std::lock_guard<std::mutex> lock(mutex);
+      const auto key = std::make_tuple(size.x,size.y,pitch);
+      auto it = types.find(key);
+      if (it != types.end())
+        return it->second;
+      MPI_Datatype type;
+      MPI_CALL(Type_vector(size.y,size.x,pitch,MPI_UINT32_T,&type));
+      MPI_CALL(Type_commit(&type));
+      types[key] = type;
+      return type;
+    }
+
     MPI::Group::Group(MPI_Comm comm)
       : comm(comm)
     {
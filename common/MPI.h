@@ -36,13 +36,25 @@ SOFTWARE.
 namespace ospray {
   namespace dw {
 
+    using namespace ospcommon;
+
     struct MPI {
       static void init(int &ac, char **&av);
 
+      /*! a (committed) datatype for a block of 'size' uint32_t pixels
+          in memory that is 'pitch' pixels wide, ie, one contiguous
+          run per row; types get created once per size and pitch, and
+          live forever. Thread-safe */
+      static MPI_Datatype pixelRows(const vec2i &size, int pitch);
+
       struct Group {
         Group(MPI_Comm comm=MPI_COMM_NULL);
         Group dup() const;
         void barrier() const { MPI_CALL(Barrier(comm)); }
+        /*! non-blocking barrier; note this does not match a blocking
+            barrier() on the other ranks */
+        MPI_Request ibarrier() const
+        { MPI_Request request; MPI_CALL(Ibarrier(comm,&request)); return request; }
 
         MPI_Comm comm;
         int rank, size;
@@ -0,0 +1,395 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*! the pixel kernels for every instruction set we support. The
+    vector versions are compiled with per-function target attributes
+    (so the rest of the library does not need any -m flags), and are
+    only ever called if the CPU reports the respective ISA at
+    runtime. Row tails that don't fill a full vector go through the
+    scalar code (or masked loads/stores, for avx512) */
+
+#include "PixelKernels.h"
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+# define DW_X86_KERNELS 1
+# include <immintrin.h>
+# define DW_TARGET(isa) __attribute__((target(isa)))
+#else
+# define DW_X86_KERNELS 0
+#endif
+
+namespace ospray {
+  namespace dw {
+
+    // =======================================================
+    // scalar kernels - also used for the row tails
+    // =======================================================
+
+    inline uint32_t swizzleOne(uint32_t v)
+    { return (v & 0xff00ff00U) | ((v >> 16) & 0xffU) | ((v & 0xffU) << 16); }
+
+    /*! per-byte (ie, per-channel) difference of two pixels, modulo 256 */
+    inline uint32_t subBytes(uint32_t a, uint32_t b)
+    { return ((a | 0x80808080U) - (b & 0x7f7f7f7fU)) ^ ((a ^ ~b) & 0x80808080U); }
+
+    /*! per-byte (ie, per-channel) sum of two pixels, modulo 256 */
+    inline uint32_t addBytes(uint32_t a, uint32_t b)
+    { return ((a & 0x7f7f7f7fU) + (b & 0x7f7f7f7fU)) ^ ((a ^ b) & 0x80808080U); }
+
+    static void copyScalar(uint32_t *dst, int dstPitch,
+                           const uint32_t *src, int srcPitch,
+                           const vec2i &size)
+    {
+      if (dstPitch == size.x && srcPitch == size.x) {
+        memcpy(dst,src,size.product()*sizeof(uint32_t));
+        return;
+      }
+      for (int iy=0;iy<size.y;iy++)
+        memcpy(dst+iy*dstPitch,src+iy*srcPitch,size.x*sizeof(uint32_t));
+    }
+
+    static void swizzleScalar(uint32_t *dst, int dstPitch,
+                              const uint32_t *src, int srcPitch,
+                              const vec2i &size)
+    {
+      for (int iy=0;iy<size.y;iy++)
+        for (int ix=0;ix<size.x;ix++)
+          dst[iy*dstPitch+ix] = swizzleOne(src[iy*srcPitch+ix]);
+    }
+
+    static void subtractScalar(uint32_t *dst, int dstPitch,
+                               const uint32_t *a, int aPitch,
+                               const uint32_t *b, int bPitch,
+                               const vec2i &size)
+    {
+      for (int iy=0;iy<size.y;iy++)
+        for (int ix=0;ix<size.x;ix++)
+          dst[iy*dstPitch+ix] = subBytes(a[iy*aPitch+ix],b[iy*bPitch+ix]);
+    }
+
+    static void addScalar(uint32_t *dst, int dstPitch,
+                          const uint32_t *a, int aPitch,
+                          const uint32_t *b, int bPitch,
+                          const vec2i &size)
+    {
+      for (int iy=0;iy<size.y;iy++)
+        for (int ix=0;ix<size.x;ix++)
+          dst[iy*dstPitch+ix] = addBytes(a[iy*aPitch+ix],b[iy*bPitch+ix]);
+    }
+
+    static const PixelKernels scalarKernels = {
+      "scalar", copyScalar, swizzleScalar, subtractScalar, addScalar
+    };
+
+#if DW_X86_KERNELS
+    // =======================================================
+    // sse4 kernels - 4 pixels per instruction
+    // =======================================================
+
+    DW_TARGET("sse4.1")
+    static void copySSE4(uint32_t *dst, int dstPitch,
+                         const uint32_t *src, int srcPitch,
+                         const vec2i &size)
+    {
+      for (int iy=0;iy<size.y;iy++) {
+        uint32_t *out = dst + iy*dstPitch;
+        const uint32_t *in = src + iy*srcPitch;
+        int ix = 0;
+        for (;ix+4<=size.x;ix+=4)
+          _mm_storeu_si128((__m128i*)(out+ix),_mm_loadu_si128((const __m128i*)(in+ix)));
+        for (;ix<size.x;ix++)
+          out[ix] = in[ix];
+      }
+    }
+
+    DW_TARGET("sse4.1")
+    static void swizzleSSE4(uint32_t *dst, int dstPitch,
+                            const uint32_t *src, int srcPitch,
+                            const vec2i &size)
+    {
+      const __m128i shuffle = _mm_setr_epi8(2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15);
+      for (int iy=0;iy<size.y;iy++) {
+        uint32_t *out = dst + iy*dstPitch;
+        const uint32_t *in = src + iy*srcPitch;
+        int ix = 0;
+        for (;ix+4<=size.x;ix+=4) {
+          const __m128i v = _mm_loadu_si128((const __m128i*)(in+ix));
+          _mm_storeu_si128((__m128i*)(out+ix),_mm_shuffle_epi8(v,shuffle));
+        }
+        for (;ix<size.x;ix++)
+          out[ix] = swizzleOne(in[ix]);
+      }
+    }
+
+    DW_TARGET("sse4.1")
+    static void subtractSSE4(uint32_t *dst, int dstPitch,
+                             const uint32_t *a, int aPitch,
+                             const uint32_t *b, int bPitch,
+                             const vec2i &size)
+    {
+      for (int iy=0;iy<size.y;iy++) {
+        uint32_t *out = dst + iy*dstPitch;
+        const uint32_t *ia = a + iy*aPitch;
+        const uint32_t *ib = b + iy*bPitch;
+        int ix = 0;
+        for (;ix+4<=size.x;ix+=4)
+          _mm_storeu_si128((__m128i*)(out+ix),
+                           _mm_sub_epi8(_mm_loadu_si128((const __m128i*)(ia+ix)),
+                                        _mm_loadu_si128((const __m128i*)(ib+ix))));
+        for (;ix<size.x;ix++)
+          out[ix] = subBytes(ia[ix],ib[ix]);
+      }
+    }
+
+    DW_TARGET("sse4.1")
+    static void addSSE4(uint32_t *dst, int dstPitch,
+                        const uint32_t *a, int aPitch,
+                        const uint32_t *b, int bPitch,
+                        const vec2i &size)
+    {
+      for (int iy=0;iy<size.y;iy++) {
+        uint32_t *out = dst + iy*dstPitch;
+        const uint32_t *ia = a + iy*aPitch;
+        const uint32_t *ib = b + iy*bPitch;
+        int ix = 0;
+        for (;ix+4<=size.x;ix+=4)
+          _mm_storeu_si128((__m128i*)(out+ix),
+                           _mm_add_epi8(_mm_loadu_si128((const __m128i*)(ia+ix)),
+                                        _mm_loadu_si128((const __m128i*)(ib+ix))));
+        for (;ix<size.x;ix++)
+          out[ix] = addBytes(ia[ix],ib[ix]);
+      }
+    }
+
+    static const PixelKernels sse4Kernels = {
+      "sse4", copySSE4, swizzleSSE4, subtractSSE4, addSSE4
+    };
+
+    // =======================================================
+    // avx2 kernels - 8 pixels per instruction
+    // =======================================================
+
+    DW_TARGET("avx2")
+    static void copyAVX2(uint32_t *dst, int dstPitch,
+                         const uint32_t *src, int srcPitch,
+                         const vec2i &size)
+    {
+      for (int iy=0;iy<size.y;iy++) {
+        uint32_t *out = dst + iy*dstPitch;
+        const uint32_t *in = src + iy*srcPitch;
+        int ix = 0;
+        for (;ix+8<=size.x;ix+=8)
+          _mm256_storeu_si256((__m256i*)(out+ix),_mm256_loadu_si256((const __m256i*)(in+ix)));
+        for (;ix<size.x;ix++)
+          out[ix] = in[ix];
+      }
+    }
+
+    DW_TARGET("avx2")
+    static void swizzleAVX2(uint32_t *dst, int dstPitch,
+                            const uint32_t *src, int srcPitch,
+                            const vec2i &size)
+    {
+      // vpshufb shuffles within each 128-bit lane, so the pattern is
+      // simply repeated for the upper lane
+      const __m256i shuffle = _mm256_setr_epi8(2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15,
+                                               2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15);
+      for (int iy=0;iy<size.y;iy++) {
+        uint32_t *out = dst + iy*dstPitch;
+        const uint32_t *in = src + iy*srcPitch;
+        int ix = 0;
+        for (;ix+8<=size.x;ix+=8) {
+          const __m256i v = _mm256_loadu_si256((const __m256i*)(in+ix));
+          _mm256_storeu_si256((__m256i*)(out+ix),_mm256_shuffle_epi8(v,shuffle));
+        }
+        for (;ix<size.x;ix++)
+          out[ix] = swizzleOne(in[ix]);
+      }
+    }
+
+    DW_TARGET("avx2")
+    static void subtractAVX2(uint32_t *dst, int dstPitch,
+                             const uint32_t *a, int aPitch,
+                             const uint32_t *b, int bPitch,
+                             const vec2i &size)
+    {
+      for (int iy=0;iy<size.y;iy++) {
+        uint32_t *out = dst + iy*dstPitch;
+        const uint32_t *ia = a + iy*aPitch;
+        const uint32_t *ib = b + iy*bPitch;
+        int ix = 0;
+        for (;ix+8<=size.x;ix+=8)
+          _mm256_storeu_si256((__m256i*)(out+ix),
+                              _mm256_sub_epi8(_mm256_loadu_si256((const __m256i*)(ia+ix)),
+                                              _mm256_loadu_si256((const __m256i*)(ib+ix))));
+        for (;ix<size.x;ix++)
+          out[ix] = subBytes(ia[ix],ib[ix]);
+      }
+    }
+
+    DW_TARGET("avx2")
+    static void addAVX2(uint32_t *dst, int dstPitch,
+                        const uint32_t *a, int aPitch,
+                        const uint32_t *b, int bPitch,
+                        const vec2i &size)
+    {
+      for (int iy=0;iy<size.y;iy++) {
+        uint32_t *out = dst + iy*dstPitch;
+        const uint32_t *ia = a + iy*aPitch;
+        const uint32_t *ib = b + iy*bPitch;
+        int ix = 0;
+        for (;ix+8<=size.x;ix+=8)
+          _mm256_storeu_si256((__m256i*)(out+ix),
+                              _mm256_add_epi8(_mm256_loadu_si256((const __m256i*)(ia+ix)),
+                                              _mm256_loadu_si256((const __m256i*)(ib+ix))));
+        for (;ix<size.x;ix++)
+          out[ix] = addBytes(ia[ix],ib[ix]);
+      }
+    }
+
+    static const PixelKernels avx2Kernels = {
+      "avx2", copyAVX2, swizzleAVX2, subtractAVX2, addAVX2
+    };
+
+    // =======================================================
+    // avx512 kernels - 16 pixels per instruction, masked tails
+    // =======================================================
+
+    inline __mmask16 tailMask(int n)
+    { return (__mmask16)((1U << n) - 1); }
+
+    DW_TARGET("avx512f,avx512bw")
+    static void copyAVX512(uint32_t *dst, int dstPitch,
+                           const uint32_t *src, int srcPitch,
+                           const vec2i &size)
+    {
+      const __mmask16 tail = tailMask(size.x % 16);
+      for (int iy=0;iy<size.y;iy++) {
+        uint32_t *out = dst + iy*dstPitch;
+        const uint32_t *in = src + iy*srcPitch;
+        int ix = 0;
+        for (;ix+16<=size.x;ix+=16)
+          _mm512_storeu_si512(out+ix,_mm512_loadu_si512(in+ix));
+        if (tail)
+          _mm512_mask_storeu_epi32(out+ix,tail,_mm512_maskz_loadu_epi32(tail,in+ix));
+      }
+    }
+
+    DW_TARGET("avx512f,avx512bw")
+    static void swizzleAVX512(uint32_t *dst, int dstPitch,
+                              const uint32_t *src, int srcPitch,
+                              const vec2i &size)
+    {
+      const __m512i shuffle
+        = _mm512_broadcast_i32x4(_mm_setr_epi8(2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15));
+      const __mmask16 tail = tailMask(size.x % 16);
+      for (int iy=0;iy<size.y;iy++) {
+        uint32_t *out = dst + iy*dstPitch;
+        const uint32_t *in = src + iy*srcPitch;
+        int ix = 0;
+        for (;ix+16<=size.x;ix+=16)
+          _mm512_storeu_si512(out+ix,_mm512_shuffle_epi8(_mm512_loadu_si512(in+ix),shuffle));
+        if (tail)
+          _mm512_mask_storeu_epi32(out+ix,tail,
+                                   _mm512_shuffle_epi8(_mm512_maskz_loadu_epi32(tail,in+ix),
+                                                       shuffle));
+      }
+    }
+
+    DW_TARGET("avx512f,avx512bw")
+    static void subtractAVX512(uint32_t *dst, int dstPitch,
+                               const uint32_t *a, int aPitch,
+                               const uint32_t *b, int bPitch,
+                               const vec2i &size)
+    {
+      const __mmask16 tail = tailMask(size.x % 16);
+      for (int iy=0;iy<size.y;iy++) {
+        uint32_t *out = dst + iy*dstPitch;
+        const uint32_t *ia = a + iy*aPitch;
+        const uint32_t *ib = b + iy*bPitch;
+        int ix = 0;
+        for (;ix+16<=size.x;ix+=16)
+          _mm512_storeu_si512(out+ix,_mm512_sub_epi8(_mm512_loadu_si512(ia+ix),
+                                                     _mm512_loadu_si512(ib+ix)));
+        if (tail)
+          _mm512_mask_storeu_epi32(out+ix,tail,
+                                   _mm512_sub_epi8(_mm512_maskz_loadu_epi32(tail,ia+ix),
+                                                   _mm512_maskz_loadu_epi32(tail,ib+ix)));
+      }
+    }
+
+    DW_TARGET("avx512f,avx512bw")
+    static void addAVX512(uint32_t *dst, int dstPitch,
+                          const uint32_t *a, int aPitch,
+                          const uint32_t *b, int bPitch,
+                          const vec2i &size)
+    {
+      const __mmask16 tail = tailMask(size.x % 16);
+      for (int iy=0;iy<size.y;iy++) {
+        uint32_t *out = dst + iy*dstPitch;
+        const uint32_t *ia = a + iy*aPitch;
+        const uint32_t *ib = b + iy*bPitch;
+        int ix = 0;
+        for (;ix+16<=size.x;ix+=16)
+          _mm512_storeu_si512(out+ix,_mm512_add_epi8(_mm512_loadu_si512(ia+ix),
+                                                     _mm512_loadu_si512(ib+ix)));
+        if (tail)
+          _mm512_mask_storeu_epi32(out+ix,tail,
+                                   _mm512_add_epi8(_mm512_maskz_loadu_epi32(tail,ia+ix),
+                                                   _mm512_maskz_loadu_epi32(tail,ib+ix)));
+      }
+    }
+
+    static const PixelKernels avx512Kernels = {
+      "avx512", copyAVX512, swizzleAVX512, subtractAVX512, addAVX512
+    };
+#endif
+
+    // =======================================================
+    // runtime dispatch
+    // =======================================================
+
+    std::vector<const PixelKernels *> PixelKernels::allSupported()
+    {
+      std::vector<const PixelKernels *> result;
+      result.push_back(&scalarKernels);
+#if DW_X86_KERNELS
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("sse4.1"))
+        result.push_back(&sse4Kernels);
+      if (__builtin_cpu_supports("avx2"))
+        result.push_back(&avx2Kernels);
+      if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        result.push_back(&avx512Kernels);
+#endif
+      return result;
+    }
+
+    const PixelKernels &PixelKernels::best()
+    {
+      static const PixelKernels *best = allSupported().back();
+      return *best;
+    }
+
+  } // ::ospray::dw
+} // ::ospray
@@ -0,0 +1,101 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "ospcommon/box.h"
+#include <vector>
+
+namespace ospray {
+  namespace dw {
+
+    using namespace ospcommon;
+
+    /*! one set of kernels for the (memory-bound) pixel operations on
+        the raw tile paths, all working on 2D blocks of 32-bit pixels
+        in (possibly differently) pitched buffers; all pitches are in
+        pixels. We compile one set per instruction set, and pick the
+        best one the CPU supports at runtime */
+    struct PixelKernels {
+      /*! name of the instruction set ("scalar", "sse4", "avx2", "avx512") */
+      const char *isa;
+
+      /*! copy a block of pixels (ie, pack/unpack tiles to/from
+          strided frame buffers) */
+      void (*copy)(uint32_t *dst, int dstPitch,
+                   const uint32_t *src, int srcPitch,
+                   const vec2i &size);
+      /*! copy a block of pixels, swapping the first and third
+          channel of every pixel (ie, RGBA <-> BGRA) */
+      void (*swizzle)(uint32_t *dst, int dstPitch,
+                      const uint32_t *src, int srcPitch,
+                      const vec2i &size);
+      /*! per-channel difference (modulo 256), dst = a - b */
+      void (*subtract)(uint32_t *dst, int dstPitch,
+                       const uint32_t *a, int aPitch,
+                       const uint32_t *b, int bPitch,
+                       const vec2i &size);
+      /*! per-channel sum (modulo 256), dst = a + b */
+      void (*add)(uint32_t *dst, int dstPitch,
+                  const uint32_t *a, int aPitch,
+                  const uint32_t *b, int bPitch,
+                  const vec2i &size);
+
+      /*! the best kernels this CPU supports */
+      static const PixelKernels &best();
+      /*! all kernel sets this CPU supports, from scalar upwards (for
+          benchmarking and testing) */
+      static std::vector<const PixelKernels *> allSupported();
+    };
+
+    /*! @{ convenience wrappers that dispatch to the best kernels */
+    inline void copyPixels(uint32_t *dst, int dstPitch,
+                           const uint32_t *src, int srcPitch,
+                           const vec2i &size)
+    { PixelKernels::best().copy(dst,dstPitch,src,srcPitch,size); }
+
+    inline void swizzlePixels(uint32_t *dst, int dstPitch,
+                              const uint32_t *src, int srcPitch,
+                              const vec2i &size)
+    { PixelKernels::best().swizzle(dst,dstPitch,src,srcPitch,size); }
+
+    /*! per-channel difference (modulo 256) of 'pixel' and
+        'reference', written to 'residual' */
+    inline void subtractPixels(uint32_t *residual, int residualPitch,
+                               const uint32_t *pixel, int pixelPitch,
+                               const uint32_t *reference, int referencePitch,
+                               const vec2i &size)
+    { PixelKernels::best().subtract(residual,residualPitch,pixel,pixelPitch,
+                                    reference,referencePitch,size); }
+
+    /*! inverse of subtractPixels: per-channel sum (modulo 256) of
+        'reference' and 'residual', written to 'out' */
+    inline void addPixels(uint32_t *out, int outPitch,
+                          const uint32_t *reference, int referencePitch,
+                          const uint32_t *residual, int residualPitch,
+                          const vec2i &size)
+    { PixelKernels::best().add(out,outPitch,reference,referencePitch,
+                               residual,residualPitch,size); }
+    /*! @} */
+
+  } // ::ospray::dw
+} // ::ospray
@@ -0,0 +1,174 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*! a lossless, image-aware codec using the pixel ops of the "quite
+    ok image" format: runs of identical pixels, a small cache of
+    recently seen colors, and small per-channel deltas to the previous
+    pixel. Pixels are visited in scanline order of the tile's region;
+    there's no file header since region and size are already in the
+    tile header */
+
+#include "TileCodec.h"
+#include "CompressedTile.h"
+
+namespace ospray {
+  namespace dw {
+
+#define QOI_OP_INDEX 0x00 /* 00xxxxxx */
+#define QOI_OP_DIFF  0x40 /* 01xxxxxx */
+#define QOI_OP_LUMA  0x80 /* 10xxxxxx */
+#define QOI_OP_RUN   0xc0 /* 11xxxxxx */
+#define QOI_OP_RGB   0xfe /* 11111110 */
+#define QOI_OP_RGBA  0xff /* 11111111 */
+#define QOI_MASK_2   0xc0 /* 11000000 */
+
+    /*! a pixel, viewed as its four byte-sized channels */
+    union QOIPixel {
+      struct { unsigned char c0, c1, c2, c3; };
+      uint32_t v;
+    };
+
+    inline int qoiHash(const QOIPixel &p)
+    { return (p.c0*3 + p.c1*5 + p.c2*7 + p.c3*11) & 63; }
+
+    struct QOICodec : public TileCodec {
+      virtual size_t maxEncodedSize(const vec2i &size) const override
+      { return size.product()*5; }
+
+      virtual size_t encode(unsigned char *out, const PlainTile &tile) override
+      {
+        const vec2i size = tile.size();
+        unsigned char *op = out;
+
+        QOIPixel index[64];
+        memset(index,0,sizeof(index));
+        QOIPixel prev; prev.v = 0; prev.c3 = 255;
+        int run = 0;
+
+        for (int iy=0;iy<size.y;iy++) {
+          const uint32_t *in = tile.pixel + iy*tile.pitch;
+          for (int ix=0;ix<size.x;ix++) {
+            QOIPixel px; px.v = in[ix];
+
+            if (px.v == prev.v) {
+              if (++run == 62) { *op++ = QOI_OP_RUN | (run-1); run = 0; }
+              continue;
+            }
+            if (run > 0) { *op++ = QOI_OP_RUN | (run-1); run = 0; }
+
+            const int h = qoiHash(px);
+            if (index[h].v == px.v) {
+              *op++ = QOI_OP_INDEX | h;
+            } else {
+              index[h] = px;
+              if (px.c3 == prev.c3) {
+                const signed char vr = px.c0 - prev.c0;
+                const signed char vg = px.c1 - prev.c1;
+                const signed char vb = px.c2 - prev.c2;
+                const signed char vg_r = vr - vg;
+                const signed char vg_b = vb - vg;
+                if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                  *op++ = QOI_OP_DIFF | ((vr+2) << 4) | ((vg+2) << 2) | (vb+2);
+                } else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8) {
+                  *op++ = QOI_OP_LUMA | (vg+32);
+                  *op++ = ((vg_r+8) << 4) | (vg_b+8);
+                } else {
+                  *op++ = QOI_OP_RGB;
+                  *op++ = px.c0;
+                  *op++ = px.c1;
+                  *op++ = px.c2;
+                }
+              } else {
+                *op++ = QOI_OP_RGBA;
+                *op++ = px.c0;
+                *op++ = px.c1;
+                *op++ = px.c2;
+                *op++ = px.c3;
+              }
+            }
+            prev = px;
+          }
+        }
+        if (run > 0) *op++ = QOI_OP_RUN | (run-1);
+        return op - out;
+      }
+
+      virtual void decode(PlainTile &tile, const unsigned char *in, size_t numBytes) override
+      {
+        const vec2i size = tile.size();
+        const unsigned char *ip   = in;
+        const unsigned char *iend = in + numBytes;
+
+        QOIPixel index[64];
+        memset(index,0,sizeof(index));
+        QOIPixel px; px.v = 0; px.c3 = 255;
+        int run = 0;
+
+        for (int iy=0;iy<size.y;iy++) {
+          uint32_t *out = tile.pixel + iy*tile.pitch;
+          for (int ix=0;ix<size.x;ix++) {
+            if (run > 0) {
+              --run;
+            } else {
+              if (ip >= iend) throw std::runtime_error("qoi codec: corrupt input");
+              const int b1 = *ip++;
+              if (b1 == QOI_OP_RGB) {
+                if (iend-ip < 3) throw std::runtime_error("qoi codec: corrupt input");
+                px.c0 = *ip++;
+                px.c1 = *ip++;
+                px.c2 = *ip++;
+              } else if (b1 == QOI_OP_RGBA) {
+                if (iend-ip < 4) throw std::runtime_error("qoi codec: corrupt input");
+                px.c0 = *ip++;
+                px.c1 = *ip++;
+                px.c2 = *ip++;
+                px.c3 = *ip++;
+              } else if ((b1 & QOI_MASK_2) == QOI_OP_INDEX) {
+                px = index[b1];
+              } else if ((b1 & QOI_MASK_2) == QOI_OP_DIFF) {
+                px.c0 += ((b1 >> 4) & 0x03) - 2;
+                px.c1 += ((b1 >> 2) & 0x03) - 2;
+                px.c2 += ( b1       & 0x03) - 2;
+              } else if ((b1 & QOI_MASK_2) == QOI_OP_LUMA) {
+                if (ip >= iend) throw std::runtime_error("qoi codec: corrupt input");
+                const int b2 = *ip++;
+                const int vg = (b1 & 0x3f) - 32;
+                px.c0 += vg - 8 + ((b2 >> 4) & 0x0f);
+                px.c1 += vg;
+                px.c2 += vg - 8 +  (b2       & 0x0f);
+              } else {
+                run = (b1 & 0x3f);
+              }
+              index[qoiHash(px)] = px;
+            }
+            out[ix] = px.v;
+          }
+        }
+        if (run > 0 || ip != iend)
+          throw std::runtime_error("qoi codec: tile size mismatch");
+      }
+    };
+
+    TileCodec *createQOICodec() { return new QOICodec; }
+
+  } // ::ospray::dw
+} // ::ospray
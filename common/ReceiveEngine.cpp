@@ -0,0 +1,116 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "ReceiveEngine.h"
+#include <thread>
+
+namespace ospray {
+  namespace dw {
+
+    ReceiveEngine::ReceiveEngine(const MPI::Group &group, int numSlots)
+      : group(group),
+        request(numSlots,MPI_REQUEST_NULL),
+        buffer(numSlots,NULL)
+    {
+      for (int slot=0;slot<numSlots;slot++) {
+        buffer[slot] = (unsigned char *)BufferPool::allocate(TILE_BATCH_SLOT_BYTES);
+        post(slot);
+      }
+    }
+
+    ReceiveEngine::~ReceiveEngine()
+    {
+      for (size_t slot=0;slot<request.size();slot++) {
+        // no MPI_CALL() here - we must not throw from a destructor
+        if (request[slot] != MPI_REQUEST_NULL) {
+          MPI_Cancel(&request[slot]);
+          MPI_Wait(&request[slot],MPI_STATUS_IGNORE);
+        }
+        BufferPool::release(buffer[slot]);
+      }
+    }
+
+    void ReceiveEngine::post(int slot)
+    {
+      MPI_CALL(Irecv(buffer[slot],TILE_BATCH_SLOT_BYTES,MPI_BYTE,
+                     MPI_ANY_SOURCE,TILE_BATCH_TAG,group.comm,&request[slot]));
+    }
+
+    bool ReceiveEngine::takeReceivedLocked(TileBatch &batch)
+    {
+      int done = 0;
+      int slot = MPI_UNDEFINED;
+      MPI_Status status;
+      MPI_CALL(Testany(request.size(),request.data(),&slot,&done,&status));
+      if (!done || slot == MPI_UNDEFINED)
+        return false;
+
+      int count = 0;
+      MPI_CALL(Get_count(&status,MPI_BYTE,&count));
+      /* hand the slot's buffer to the batch, and re-post the slot
+         with the batch's old buffer if that is large enough */
+      unsigned char *received = buffer[slot];
+      if (BufferPool::capacityOf(batch.data) >= TILE_BATCH_SLOT_BYTES)
+        buffer[slot] = batch.data;
+      else {
+        BufferPool::release(batch.data);
+        buffer[slot] = (unsigned char *)BufferPool::allocate(TILE_BATCH_SLOT_BYTES);
+      }
+      post(slot);
+      batch.data     = received;
+      batch.numBytes = count;
+      batch.numTiles = -1; // unknown until we iterate
+      batch.fromRank = status.MPI_SOURCE;
+      return true;
+    }
+
+    void ReceiveEngine::receive(TileBatch &batch)
+    {
+      while (!tryReceive(batch))
+        std::this_thread::yield();
+    }
+
+    bool ReceiveEngine::tryReceive(TileBatch &batch)
+    {
+      int done = 0;
+      MPI_Status status;
+      {
+        /* if another thread is testing the slots, don't wait for
+           it; it will take whatever they received */
+        std::unique_lock<std::mutex> lock(mutex,std::try_to_lock);
+        if (lock.owns_lock() && takeReceivedLocked(batch))
+          return true;
+      }
+
+      /* matched probes are safe without the lock */
+      MPI_Message message;
+      MPI_CALL(Improbe(MPI_ANY_SOURCE,TILE_BATCH_LARGE_TAG,group.comm,
+                       &done,&message,&status));
+      if (!done)
+        return false;
+      batch.receive(message,status);
+      return true;
+    }
+
+  } // ::ospray::dw
+} // ::ospray
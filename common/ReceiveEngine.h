@@ -0,0 +1,73 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "TileBatch.h"
+#include <mutex>
+#include <vector>
+
+namespace ospray {
+  namespace dw {
+
+    /*! receives tile batches through a ring of pre-posted MPI_Irecv's,
+        one per slot, each with a buffer of TILE_BATCH_SLOT_BYTES from
+        the buffer pool: a batch that arrives gets taken over by the
+        receiving thread (no copy), and its slot gets re-posted with a
+        recycled buffer. Batches too large for a slot get sent with
+        TILE_BATCH_LARGE_TAG (see TileBatch::sendTo()), and received
+        with a matched probe.
+
+        Several threads may call receive() at the same time. Only one
+        of them tests the slots at any time, so no two threads ever
+        race for the same message; that only takes a lock for the
+        test itself (and for re-posting a slot), and a thread that
+        finds the slots taken looks for large batches instead of
+        waiting, so threads don't wait for each other while there's
+        nothing to receive */
+    struct ReceiveEngine {
+      ReceiveEngine(const MPI::Group &group, int numSlots = 16);
+      /*! cancels all pending receives */
+      ~ReceiveEngine();
+
+      /*! receive the next batch (from any rank) into 'batch',
+          replacing its previous content */
+      void receive(TileBatch &batch);
+      /*! same as receive(), but doesn't wait: returns whether there
+          was a batch */
+      bool tryReceive(TileBatch &batch);
+
+    private:
+      void post(int slot);
+      /*! if some slot has received a batch, take it (and re-post the
+          slot); requires 'mutex' to be held */
+      bool takeReceivedLocked(TileBatch &batch);
+
+      std::mutex                   mutex;
+      MPI::Group                   group;
+      std::vector<MPI_Request>     request;
+      std::vector<unsigned char *> buffer;
+    };
+
+  } // ::ospray::dw
+} // ::ospray
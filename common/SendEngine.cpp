@@ -0,0 +1,204 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "SendEngine.h"
+
+namespace ospray {
+  namespace dw {
+
+    SendEngine::SendEngine(const MPI::Group &group,
+                           int maxInFlight,
+                           size_t maxBacklogBytes)
+      : maxInFlight(maxInFlight),
+        maxBacklogBytes(maxBacklogBytes),
+        group(group),
+        numBytesPending(0),
+        busySince(0.),
+        busySeconds(0.),
+        numBytesSent(0)
+    {}
+
+    SendEngine::~SendEngine()
+    {
+      drain();
+      for (auto send : unused)
+        delete send;
+    }
+
+    void SendEngine::post(Send *send)
+    {
+      if (inFlight.empty())
+        busySince = getSysTime();
+      if (send->tag >= 0) {
+        MPI_Request request;
+        MPI_CALL(Isend(send->batch.data,send->batch.numBytes,MPI_BYTE,
+                       send->rank,send->tag,group.comm,&request));
+        send->requests.push_back(request);
+      } else if (send->parts.empty())
+        send->requests.push_back(send->batch.isendTo(group,send->rank));
+      else
+        for (auto &part : send->parts)
+          send->requests.push_back(send->batch.isendTo(group,part.first,part.second));
+      inFlight.push_back(send);
+    }
+
+    /*! remove (completed) in-flight send #inFlightID */
+    void SendEngine::retire(size_t inFlightID)
+    {
+      Send *send = inFlight[inFlightID];
+      inFlight[inFlightID] = inFlight.back();
+      inFlight.pop_back();
+      numBytesPending -= send->batch.numBytes;
+      if (send->parts.empty())
+        numBytesSent += send->batch.numBytes;
+      else
+        for (auto &part : send->parts)
+          numBytesSent += part.second.totalBytes;
+      send->batch.clear();
+      send->parts.clear();
+      send->requests.clear();
+      unused.push_back(send);
+      if (inFlight.empty())
+        busySeconds += getSysTime() - busySince;
+    }
+
+    void SendEngine::progressLocked()
+    {
+      for (size_t i=0;i<inFlight.size();) {
+        int done = 0;
+        MPI_CALL(Testall(inFlight[i]->requests.size(),inFlight[i]->requests.data(),
+                         &done,MPI_STATUSES_IGNORE));
+        if (done)
+          retire(i);
+        else
+          ++i;
+      }
+      while (!queued.empty() && (int)inFlight.size() < maxInFlight) {
+        post(queued.front());
+        queued.pop_front();
+      }
+    }
+
+    SendEngine::Send *SendEngine::newSendLocked()
+    {
+      if (unused.empty())
+        return new Send;
+      Send *send = unused.back();
+      unused.pop_back();
+      return send;
+    }
+
+    void SendEngine::queueLocked(Send *send)
+    {
+      numBytesPending += send->batch.numBytes;
+      queued.push_back(send);
+      progressLocked();
+
+      /* back-pressure: wait for the oldest sends until the backlog
+         is small enough again. We keep holding the lock while doing
+         so, so other senders get throttled, too */
+      while (numBytesPending > maxBacklogBytes && !inFlight.empty()) {
+        MPI_CALL(Waitall(inFlight[0]->requests.size(),inFlight[0]->requests.data(),
+                         MPI_STATUSES_IGNORE));
+        retire(0);
+        progressLocked();
+      }
+    }
+
+    void SendEngine::send(TileBatch &batch, const int rank)
+    {
+      send(batch,rank,-1);
+    }
+
+    void SendEngine::send(TileBatch &batch, const int rank, const int tag)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      Send *send = newSendLocked();
+      send->batch.swap(batch);
+      send->rank = rank;
+      send->tag  = tag;
+      queueLocked(send);
+    }
+
+    void SendEngine::send(TileBatch &batch,
+                          std::vector<std::pair<int,TileRanges>> &parts)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      Send *send = newSendLocked();
+      send->batch.swap(batch);
+      send->rank = -1;
+      send->tag  = -1;
+      send->parts.swap(parts);
+      queueLocked(send);
+    }
+
+    void SendEngine::progress()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      progressLocked();
+    }
+
+    void SendEngine::postAll()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      progressLocked();
+      while (!queued.empty()) {
+        post(queued.front());
+        queued.pop_front();
+      }
+    }
+
+    void SendEngine::drain()
+    {
+      postAll();
+      std::lock_guard<std::mutex> lock(mutex);
+      while (!inFlight.empty()) {
+        MPI_CALL(Waitall(inFlight.back()->requests.size(),inFlight.back()->requests.data(),
+                         MPI_STATUSES_IGNORE));
+        retire(inFlight.size()-1);
+      }
+    }
+
+    void SendEngine::takeSendStats(size_t &numBytesSent, double &busySeconds)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      progressLocked();
+      numBytesSent = this->numBytesSent;
+      busySeconds  = this->busySeconds;
+      this->numBytesSent = 0;
+      this->busySeconds  = 0.;
+      if (!inFlight.empty()) {
+        const double now = getSysTime();
+        busySeconds += now - busySince;
+        busySince = now;
+      }
+    }
+
+    size_t SendEngine::backlogBytes()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return numBytesPending;
+    }
+
+  } // ::ospray::dw
+} // ::ospray
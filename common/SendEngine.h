@@ -0,0 +1,125 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "TileBatch.h"
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace ospray {
+  namespace dw {
+
+    /*! sends tile batches with non-blocking MPI_Isend's, so whoever
+        hands us a batch (eg, a render thread) doesn't have to wait
+        for the network. The engine takes over the batch's memory
+        until the send completes; at most 'maxInFlight' sends are
+        posted at any time, the rest wait in a queue. Once more than
+        'maxBacklogBytes' are queued or in flight, send() blocks until
+        enough sends completed - so a slow receiver throttles the
+        sender instead of making it buffer without bounds.
+
+        Completed sends only get noticed (and their memory recycled)
+        in progress(), which every send() calls, too. Thread-safe */
+    struct SendEngine {
+      SendEngine(const MPI::Group &group,
+                 int    maxInFlight = 64,
+                 size_t maxBacklogBytes = 64*1024*1024);
+      /*! waits for all pending sends */
+      ~SendEngine();
+
+      /*! send the batch's tiles to the given rank; takes over the
+          batch's content, leaving 'batch' empty (but with some
+          recycled memory) */
+      void send(TileBatch &batch, const int targetRank);
+      /*! like send(), but sends the batch's bytes as they are, with
+          the given tag, rather than as a tile batch (eg, a strided
+          tile's pixels, see CompressedTile::encodeStrided()) */
+      void send(TileBatch &batch, const int targetRank, const int tag);
+      /*! send different subsets of the batch's tiles to different
+          ranks, each as one message, straight out of the batch's
+          memory (see TileRanges); takes over the batch (and the
+          parts) like send(), and only recycles the batch's memory
+          once all parts have been sent */
+      void send(TileBatch &batch,
+                std::vector<std::pair<int,TileRanges>> &parts);
+      /*! recycle completed sends, and post queued ones */
+      void progress();
+      /*! post all queued sends, ignoring maxInFlight, without
+          waiting for any of them; once that returns, all data is 'on
+          its way', and it's safe to enter a barrier that the
+          receivers will only reach after receiving it */
+      void postAll();
+      /*! wait until all sends have completed */
+      void drain();
+
+      /*! returns the number of bytes whose sends completed since the
+          last call, and the time (in seconds) during which at least
+          one send was in flight since then; both cover the same span
+          of time. Completed sends only get noticed in progress(), so
+          busySeconds tends to run long, and numBytesSent/busySeconds
+          is a lower bound for the bandwidth the sends actually got */
+      void takeSendStats(size_t &numBytesSent, double &busySeconds);
+      /*! bytes currently queued or in flight (for whole-batch
+          sends; for multi-part sends, the size of the batch) */
+      size_t backlogBytes();
+
+      int    maxInFlight;
+      size_t maxBacklogBytes;
+
+    private:
+      struct Send {
+        TileBatch   batch;
+        /*! either the entire batch goes to 'rank', or each of the
+            'parts' to its rank */
+        int         rank;
+        /*! if >= 0, the batch is just bytes, to go with this tag */
+        int         tag;
+        std::vector<std::pair<int,TileRanges>> parts;
+        std::vector<MPI_Request> requests;
+      };
+      /*! all 'xyzLocked()' functions require 'mutex' to be held */
+      Send *newSendLocked();
+      void queueLocked(Send *send);
+      void post(Send *send);
+      void progressLocked();
+      void retire(size_t inFlightID);
+
+      std::mutex          mutex;
+      MPI::Group          group;
+      std::vector<Send *> inFlight;
+      std::deque<Send *>  queued;
+      /*! completed sends, for re-use */
+      std::vector<Send *> unused;
+      /*! bytes in queued and in-flight sends */
+      size_t              numBytesPending;
+      /*! when the current busy period started, if inFlight isn't empty */
+      double              busySince;
+      double              busySeconds;
+      /*! bytes of sends completed since the last takeSendStats() */
+      size_t              numBytesSent;
+    };
+
+  } // ::ospray::dw
+} // ::ospray
@@ -0,0 +1,246 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#include "ShmTileRing.h"
+#include <atomic>
+#include <new>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ospray {
+  namespace dw {
+
+    /*! size of each ring (not counting its header) */
+#define SHM_RING_BYTES (8*1024*1024)
+
+    /*! each tile in the ring is an 8-byte record header (the tile's
+        size in bytes, or -1 for 'continues at the start of the
+        ring'), followed by the tile, padded to a multiple of 8 bytes */
+#define SHM_RECORD_HEADER 8
+
+    /*! lives at the start of the shared memory; positions only ever
+        grow, the offset into the ring is position % capacity */
+    struct ShmTileRing::Header {
+      /*! where the producer writes next */
+      alignas(64) std::atomic<uint64_t> head;
+      /*! where the consumer reads next */
+      alignas(64) std::atomic<uint64_t> tail;
+      alignas(64) uint64_t capacity;
+    };
+
+#if ATOMIC_LLONG_LOCK_FREE != 2
+# error "shared memory tile rings need lock-free 64-bit atomics"
+#endif
+
+    static inline uint64_t paddedSize(int numBytes)
+    {
+      return (uint64_t(numBytes)+7) & ~uint64_t(7);
+    }
+
+    ShmTileRing::ShmTileRing(void *memory, size_t mappedBytes)
+      : header((Header *)memory),
+        ring((unsigned char *)memory+sizeof(Header)),
+        mappedBytes(mappedBytes)
+    {}
+
+    ShmTileRing::~ShmTileRing()
+    {
+      munmap(header,mappedBytes);
+    }
+
+    ShmTileRing *ShmTileRing::create(const std::string &name, size_t numBytes)
+    {
+      const int fd = shm_open(name.c_str(),O_CREAT|O_EXCL|O_RDWR,0600);
+      if (fd < 0)
+        return NULL;
+      const size_t mappedBytes = sizeof(Header)+numBytes;
+      /* reserve all of it now, so we find out here (rather than
+         through a SIGBUS later on) if there isn't enough shared
+         memory */
+      void *memory = NULL;
+      if (posix_fallocate(fd,0,mappedBytes) == 0)
+        memory = mmap(NULL,mappedBytes,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+      close(fd);
+      if (memory == NULL || memory == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return NULL;
+      }
+      Header *header = new (memory) Header;
+      header->head = 0;
+      header->tail = 0;
+      header->capacity = numBytes;
+      return new ShmTileRing(memory,mappedBytes);
+    }
+
+    ShmTileRing *ShmTileRing::attach(const std::string &name)
+    {
+      const int fd = shm_open(name.c_str(),O_RDWR,0600);
+      if (fd < 0)
+        return NULL;
+      struct stat info;
+      void *memory = MAP_FAILED;
+      if (fstat(fd,&info) == 0 && size_t(info.st_size) > sizeof(Header))
+        memory = mmap(NULL,info.st_size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+      close(fd);
+      if (memory == MAP_FAILED)
+        return NULL;
+      return new ShmTileRing(memory,info.st_size);
+    }
+
+    void ShmTileRing::push(const CompressedTile &tile)
+    {
+      std::lock_guard<std::mutex> lock(pushMutex);
+      const uint64_t capacity = header->capacity;
+      const uint64_t recordBytes = SHM_RECORD_HEADER+paddedSize(tile.numBytes);
+      if (recordBytes > capacity)
+        throw std::runtime_error("tile too large for shared memory tile ring");
+
+      uint64_t pos = header->head.load(std::memory_order_relaxed);
+      uint64_t ofs = pos % capacity;
+      /* records never wrap around; if this one doesn't fit at the
+         end, it goes to the start, and we lose the rest */
+      const uint64_t skipBytes = (ofs+recordBytes > capacity) ? capacity-ofs : 0;
+      for (int numTries=0;
+           pos+skipBytes+recordBytes-header->tail.load(std::memory_order_acquire) > capacity;
+           numTries++) {
+        if (numTries < 64)
+          std::this_thread::yield();
+        else
+          usleep(50);
+      }
+      if (skipBytes) {
+        const int64_t wrap = -1;
+        memcpy(ring+ofs,&wrap,sizeof(wrap));
+        pos += skipBytes;
+        ofs = 0;
+      }
+      const int64_t numBytes = tile.numBytes;
+      memcpy(ring+ofs,&numBytes,sizeof(numBytes));
+      memcpy(ring+ofs+SHM_RECORD_HEADER,tile.data,tile.numBytes);
+      memset(ring+ofs+SHM_RECORD_HEADER+tile.numBytes,0,
+             paddedSize(tile.numBytes)-tile.numBytes);
+      header->head.store(pos+recordBytes,std::memory_order_release);
+    }
+
+    bool ShmTileRing::popAll(TileBatch &batch)
+    {
+      const uint64_t capacity = header->capacity;
+      uint64_t pos = header->tail.load(std::memory_order_relaxed);
+      const uint64_t end = header->head.load(std::memory_order_acquire);
+      if (pos == end)
+        return false;
+      while (pos < end) {
+        const uint64_t ofs = pos % capacity;
+        int64_t numBytes;
+        memcpy(&numBytes,ring+ofs,sizeof(numBytes));
+        if (numBytes < 0) {
+          pos += capacity-ofs;
+          continue;
+        }
+        batch.append(CompressedTile(ring+ofs+SHM_RECORD_HEADER,numBytes,-1));
+        pos += SHM_RECORD_HEADER+paddedSize(numBytes);
+      }
+      header->tail.store(pos,std::memory_order_release);
+      return true;
+    }
+
+    /*! what each rank tells the other side about itself */
+    struct ShmRankInfo {
+      char host[MPI_MAX_PROCESSOR_NAME];
+      int  pid;
+    };
+
+    /*! the name of the ring from given display process to given client rank */
+    static std::string ringName(int displayPID, int clientRank)
+    {
+      return "/ospdw-"+std::to_string(displayPID)+"-"+std::to_string(clientRank);
+    }
+
+    std::vector<ShmTileRing *> ShmTileRing::connect(const MPI::Group &clientsAndDisplays,
+                                                    bool isDisplay)
+    {
+      assert(clientsAndDisplays.isInter);
+      ShmRankInfo mine;
+      memset(&mine,0,sizeof(mine));
+      int length = 0;
+      MPI_CALL(Get_processor_name(mine.host,&length));
+      mine.pid = getpid();
+      int myRank;
+      MPI_CALL(Comm_rank(clientsAndDisplays.comm,&myRank));
+
+      std::vector<ShmRankInfo> remote(clientsAndDisplays.size);
+      MPI_CALL(Allgather(&mine,sizeof(mine),MPI_BYTE,
+                         remote.data(),sizeof(mine),MPI_BYTE,
+                         clientsAndDisplays.comm));
+
+      std::vector<ShmTileRing *> rings(clientsAndDisplays.size,NULL);
+      /* displays create the rings before any client attaches, and
+         remove their names once all have (the rings live on until
+         both sides have unmapped them). A ring of the same name can
+         only be left over from an earlier process that had our pid,
+         and died before it could remove it, so we remove it first */
+      if (isDisplay)
+        for (int rank=0;rank<clientsAndDisplays.size;rank++)
+          if (!strcmp(remote[rank].host,mine.host)) {
+            shm_unlink(ringName(mine.pid,rank).c_str());
+            rings[rank] = create(ringName(mine.pid,rank),SHM_RING_BYTES);
+          }
+
+      /* tell the other side which rings we have - first which ones
+         got created, then which ones got attached to - so that both
+         sides end up using exactly the same rings (and send over MPI
+         for everything else) */
+      std::vector<int> haveRing(clientsAndDisplays.size), remoteHasRing(clientsAndDisplays.size);
+      for (int rank=0;rank<clientsAndDisplays.size;rank++)
+        haveRing[rank] = rings[rank] != NULL;
+      MPI_CALL(Alltoall(haveRing.data(),1,MPI_INT,
+                        remoteHasRing.data(),1,MPI_INT,
+                        clientsAndDisplays.comm));
+      if (!isDisplay)
+        for (int rank=0;rank<clientsAndDisplays.size;rank++)
+          if (remoteHasRing[rank] && !strcmp(remote[rank].host,mine.host))
+            rings[rank] = attach(ringName(remote[rank].pid,myRank));
+
+      for (int rank=0;rank<clientsAndDisplays.size;rank++)
+        haveRing[rank] = rings[rank] != NULL;
+      MPI_CALL(Alltoall(haveRing.data(),1,MPI_INT,
+                        remoteHasRing.data(),1,MPI_INT,
+                        clientsAndDisplays.comm));
+      if (isDisplay)
+        for (int rank=0;rank<clientsAndDisplays.size;rank++)
+          if (rings[rank]) {
+            shm_unlink(ringName(mine.pid,rank).c_str());
+            if (!remoteHasRing[rank]) {
+              delete rings[rank];
+              rings[rank] = NULL;
+            }
+          }
+      return rings;
+    }
+
+  } // ::ospray::dw
+} // ::ospray
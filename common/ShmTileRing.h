@@ -0,0 +1,81 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#pragma once
+
+#include "TileBatch.h"
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ospray {
+  namespace dw {
+
+    /*! a ring of encoded tiles in POSIX shared memory, from one
+        client rank to one display rank on the same node, so those
+        tiles don't have to go through MPI (whose shared memory
+        transport may not kick in for processes that got connected
+        through MPI_Comm_connect/accept). One producer process, which
+        may push from any number of threads, and one consumer thread
+        on the display; the ring itself is lock-free, and the
+        producer waits while it is full */
+    struct ShmTileRing {
+      ~ShmTileRing();
+
+      /*! find out which ranks on the other side of the given
+          clients<->displays intercomm run on the same node as we do,
+          and set up a ring with each of them: displays create one
+          ring per local client, clients attach to theirs. Collective
+          over both groups. Returns the rings, indexed by remote rank
+          (NULL for remote ranks on other nodes, or if a ring couldn't
+          be created or attached to - both sides always agree on
+          which rings there are) */
+      static std::vector<ShmTileRing *> connect(const MPI::Group &clientsAndDisplays,
+                                                bool isDisplay);
+
+      /*! (producer) append a copy of the given tile; waits while the
+          ring doesn't have room for it */
+      void push(const CompressedTile &tile);
+      /*! (consumer) append all tiles that are in the ring to the
+          given batch, and free their space in the ring; returns
+          whether there were any */
+      bool popAll(TileBatch &batch);
+
+    private:
+      struct Header;
+      ShmTileRing(void *memory, size_t mappedBytes);
+      /*! create a new ring of given name (or NULL if we can't) */
+      static ShmTileRing *create(const std::string &name, size_t numBytes);
+      /*! attach to an existing ring (or return NULL) */
+      static ShmTileRing *attach(const std::string &name);
+
+      Header        *header;
+      unsigned char *ring;
+      size_t         mappedBytes;
+      /*! serializes the producer's threads */
+      std::mutex     pushMutex;
+    };
+
+  } // ::ospray::dw
+} // ::ospray
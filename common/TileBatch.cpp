@@ -0,0 +1,253 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "TileBatch.h"
+#include "SendEngine.h"
+#include <algorithm>
+
+namespace ospray {
+  namespace dw {
+
+    TileBatch::TileBatch()
+      : data(NULL),
+        numBytes(0),
+        numTiles(0),
+        fromRank(-1)
+    {}
+
+    TileBatch::~TileBatch()
+    {
+      BufferPool::release(data);
+    }
+
+    /*! make sure data[] has room for numBytes bytes, preserving the
+        current content */
+    void TileBatch::reserve(size_t numBytes)
+    {
+      const size_t capacity = BufferPool::capacityOf(data);
+      if (capacity >= numBytes)
+        return;
+      unsigned char *newData
+        = (unsigned char *)BufferPool::allocate(std::max(numBytes,2*capacity));
+      if (this->numBytes)
+        memcpy(newData,data,this->numBytes);
+      BufferPool::release(data);
+      data = newData;
+    }
+
+    void TileBatch::append(const CompressedTile &tile)
+    {
+      memcpy(append(tile.numBytes),tile.data,tile.numBytes);
+    }
+
+    unsigned char *TileBatch::append(int tileBytes)
+    {
+      const size_t paddedBytes = (tileBytes+7) & ~size_t(7);
+      const int64_t prefix = tileBytes;
+      reserve(numBytes+sizeof(prefix)+paddedBytes);
+      unsigned char *tileData = data+numBytes+sizeof(prefix);
+      memcpy(data+numBytes,&prefix,sizeof(prefix));
+      /* don't send (or put into shared memory) whatever happened to
+         be in the buffer before */
+      memset(tileData+tileBytes,0,paddedBytes-tileBytes);
+      numBytes += sizeof(prefix)+paddedBytes;
+      ++numTiles;
+      return tileData;
+    }
+
+    void TileBatch::swap(TileBatch &other)
+    {
+      std::swap(data,other.data);
+      std::swap(numBytes,other.numBytes);
+      std::swap(numTiles,other.numTiles);
+      std::swap(fromRank,other.fromRank);
+    }
+
+    inline int tagFor(size_t numBytes)
+    {
+      return numBytes > TILE_BATCH_SLOT_BYTES ? TILE_BATCH_LARGE_TAG : TILE_BATCH_TAG;
+    }
+
+    void TileBatch::sendTo(const MPI::Group &group, const int rank) const
+    {
+      MPI_CALL(Send(data,numBytes,MPI_BYTE,rank,tagFor(numBytes),group.comm));
+    }
+
+    MPI_Request TileBatch::isendTo(const MPI::Group &group, const int rank) const
+    {
+      MPI_Request request;
+      MPI_CALL(Isend(data,numBytes,MPI_BYTE,rank,tagFor(numBytes),group.comm,&request));
+      return request;
+    }
+
+    MPI_Request TileBatch::isendTo(const MPI::Group &group, const int rank,
+                                   const TileRanges &tiles) const
+    {
+      assert(!tiles.empty());
+      MPI_Request request;
+      const int tag = tagFor(tiles.totalBytes);
+      if (tiles.offset.size() == 1) {
+        MPI_CALL(Isend(data+tiles.offset[0],tiles.numBytes[0],MPI_BYTE,
+                       rank,tag,group.comm,&request));
+      } else {
+        /* the type only has to live until the send is posted */
+        MPI_Datatype type;
+        MPI_CALL(Type_create_hindexed(tiles.offset.size(),
+                                      tiles.numBytes.data(),
+                                      tiles.offset.data(),
+                                      MPI_BYTE,&type));
+        MPI_CALL(Type_commit(&type));
+        MPI_CALL(Isend(data,1,type,rank,tag,group.comm,&request));
+        MPI_CALL(Type_free(&type));
+      }
+      return request;
+    }
+
+    void TileRanges::add(const TileBatch &batch, const CompressedTile &tile)
+    {
+      // the tile's size prefix, and the padding after its data, too
+      const MPI_Aint ofs = (tile.data - batch.data) - 8;
+      const int numBytes = 8 + ((tile.numBytes+7) & ~7);
+      assert(ofs >= 0 && ofs+numBytes <= (MPI_Aint)batch.numBytes);
+      if (!offset.empty() && offset.back()+this->numBytes.back() == ofs)
+        this->numBytes.back() += numBytes;
+      else {
+        offset.push_back(ofs);
+        this->numBytes.push_back(numBytes);
+      }
+      totalBytes += numBytes;
+    }
+
+    void TileBatch::receiveOne(const MPI::Group &group)
+    {
+      /* several threads may be receiving on the same communicator,
+         so use a matched probe: with a plain probe, another thread
+         could grab the message we just probed, and we'd receive a
+         different (and possibly larger) one */
+      MPI_Status  status;
+      MPI_Message message;
+      MPI_CALL(Mprobe(MPI_ANY_SOURCE,MPI_ANY_TAG,group.comm,&message,&status));
+      receive(message,status);
+    }
+
+    void TileBatch::receive(MPI_Message &message, const MPI_Status &probed)
+    {
+      int count = 0;
+      MPI_CALL(Get_count(&probed,MPI_BYTE,&count));
+      clear();
+      reserve(count);
+      MPI_Status status;
+      MPI_CALL(Mrecv(data,count,MPI_BYTE,&message,&status));
+      fromRank = status.MPI_SOURCE;
+      numBytes = count;
+      numTiles = -1; // unknown until we iterate
+    }
+
+    TileBatcher::TileBatcher(const MPI::Group &group,
+                             size_t maxBatchBytes,
+                             double maxBatchDelay,
+                             SendEngine *engine)
+      : maxBatchBytes(maxBatchBytes),
+        maxBatchDelay(maxBatchDelay),
+        group(group),
+        engine(engine),
+        queue(group.size),
+        nextExpiryCheck(0.)
+    {
+      for (auto &q : queue)
+        q = new Queue;
+    }
+
+    TileBatcher::~TileBatcher()
+    {
+      for (auto q : queue)
+        delete q;
+    }
+
+    void TileBatcher::sendBatch(TileBatch &batch, const int rank)
+    {
+      if (engine)
+        engine->send(batch,rank);
+      else
+        batch.sendTo(group,rank);
+    }
+
+    void TileBatcher::send(const CompressedTile &tile, const int rank)
+    {
+      assert(rank >= 0 && rank < (int)queue.size());
+      Queue &q = *queue[rank];
+
+      const double now = getSysTime();
+      TileBatch toSend;
+      {
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.batch.empty())
+          q.firstTileTime = now;
+        q.batch.append(tile);
+        if (q.batch.numBytes >= maxBatchBytes
+            || (now - q.firstTileTime) >= maxBatchDelay)
+          // take the batch, so other threads can keep appending while
+          // we send
+          toSend.swap(q.batch);
+      }
+      if (!toSend.empty())
+        sendBatch(toSend,rank);
+      flushExpired(now);
+    }
+
+    void TileBatcher::flushExpired(double now)
+    {
+      /* other ranks' batches may not get any more tiles for a while;
+         every so often, one thread looks at all of them */
+      double checkAt = nextExpiryCheck.load();
+      if (now < checkAt
+          || !nextExpiryCheck.compare_exchange_strong(checkAt,now+.5*maxBatchDelay))
+        return;
+      for (size_t rank=0;rank<queue.size();rank++) {
+        TileBatch toSend;
+        {
+          std::lock_guard<std::mutex> lock(queue[rank]->mutex);
+          if (queue[rank]->batch.empty()
+              || (now - queue[rank]->firstTileTime) < maxBatchDelay)
+            continue;
+          toSend.swap(queue[rank]->batch);
+        }
+        sendBatch(toSend,rank);
+      }
+    }
+
+    void TileBatcher::flush()
+    {
+      for (size_t rank=0;rank<queue.size();rank++) {
+        TileBatch toSend;
+        {
+          std::lock_guard<std::mutex> lock(queue[rank]->mutex);
+          if (queue[rank]->batch.empty()) continue;
+          toSend.swap(queue[rank]->batch);
+        }
+        sendBatch(toSend,rank);
+      }
+    }
+
+  } // ::ospray::dw
+} // ::ospray
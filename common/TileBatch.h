@@ -0,0 +1,177 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "CompressedTile.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace ospray {
+  namespace dw {
+
+    struct SendEngine;
+    struct TileBatch;
+
+    /*! some of a batch's tiles, as byte ranges of the batch's data
+        (each one covering one or more whole tiles, size prefix
+        included): sending just these ranges as one message gives the
+        receiver a regular batch with only these tiles, without ever
+        copying them out of the original batch */
+    struct TileRanges {
+      /*! add the given tile (which has to live in the given batch) */
+      void add(const TileBatch &batch, const CompressedTile &tile);
+      void clear() { offset.clear(); numBytes.clear(); totalBytes = 0; }
+      bool empty() const { return offset.empty(); }
+
+      std::vector<MPI_Aint> offset;
+      std::vector<int>      numBytes;
+      size_t                totalBytes { 0 };
+    };
+
+    /*! @{ batches of up to TILE_BATCH_SLOT_BYTES get sent with
+        TILE_BATCH_TAG, and can go straight into a pre-posted receive
+        buffer of that size (see ReceiveEngine); larger ones get sent
+        with TILE_BATCH_LARGE_TAG */
+#define TILE_BATCH_TAG        0
+#define TILE_BATCH_LARGE_TAG  1
+#define TILE_BATCH_SLOT_BYTES (512*1024)
+    /*! @} */
+
+    /*! a number of encoded tiles that all go to the same rank, and
+        get sent as one single message. On the wire, each tile is an
+        8-byte int (the tile's size in bytes) followed by the tile's
+        data (see CompressedTile), zero-padded to a multiple of 8
+        bytes */
+    struct TileBatch {
+      TileBatch();
+      ~TileBatch();
+
+      /*! append a copy of the given tile */
+      void append(const CompressedTile &tile);
+      /*! append room for a tile of 'numBytes' bytes, and return where
+          that tile's data goes; that only stays put until the batch
+          has to grow (see reserve()) */
+      unsigned char *append(int numBytes);
+      /*! remove all tiles (but keep the memory) */
+      void clear() { numBytes = 0; numTiles = 0; }
+      bool empty() const { return numTiles == 0; }
+      void swap(TileBatch &other);
+      /*! make sure data[] has room for at least numBytes bytes
+          (keeping the ones it has) */
+      void reserve(size_t numBytes);
+
+      /*! send all tiles in this batch to the given rank in the given
+          group, as one message */
+      void sendTo(const MPI::Group &group, const int targetRank) const;
+      /*! same as sendTo(), but non-blocking; the batch must not be
+          touched until the returned request has completed */
+      MPI_Request isendTo(const MPI::Group &group, const int targetRank) const;
+      /*! same as isendTo(), but only sends the given tiles of this
+          batch, straight from this batch's memory */
+      MPI_Request isendTo(const MPI::Group &group, const int targetRank,
+                          const TileRanges &tiles) const;
+      /*! receive one batch (from any rank) from the given group */
+      void receiveOne(const MPI::Group &group);
+      /*! receive the given message (from a matched probe) */
+      void receive(MPI_Message &message, const MPI_Status &status);
+
+      /*! call 'func(CompressedTile &)' for each tile in this batch;
+          the tiles passed to 'func' point into this batch's memory */
+      template<typename Func>
+      void forEachTile(const Func &func);
+
+      unsigned char *data;
+      size_t numBytes;
+      int    numTiles;
+      int    fromRank;
+    };
+
+    /*! collects the encoded tiles for each rank of a group into
+        TileBatch'es, and sends a rank's batch once it has grown larger
+        than a given size, or once its oldest tile has waited longer
+        than a given time. There's no timer, though: waiting batches
+        only get checked whenever some tile (for any rank) gets
+        queued, so if no more tiles come, a batch waits for flush(),
+        which sends all pending batches (and has to happen before the
+        end-of-frame barrier). Thread-safe */
+    struct TileBatcher {
+      /*! maxBatchBytes == 0 sends every tile right away. With a send
+          engine, full batches get handed to that engine (see
+          SendEngine::send()); without one, they get sent right away,
+          with blocking sends */
+      TileBatcher(const MPI::Group &group,
+                  size_t maxBatchBytes = 256*1024,
+                  double maxBatchDelay = .002,
+                  SendEngine *engine = NULL);
+      ~TileBatcher();
+
+      /*! queue the tile for the given rank */
+      void send(const CompressedTile &tile, const int targetRank);
+      /*! send all pending batches */
+      void flush();
+
+      /*! @{ batches get sent once they're larger than this many
+          bytes, or when a tile has waited longer than this many
+          seconds (and then another tile gets queued) */
+      size_t maxBatchBytes;
+      double maxBatchDelay;
+      /*! @} */
+
+    private:
+      struct Queue {
+        std::mutex mutex;
+        TileBatch  batch;
+        /*! when the batch's first tile was added */
+        double     firstTileTime;
+      };
+      void sendBatch(TileBatch &batch, const int targetRank);
+      /*! send all batches whose first tile has waited too long */
+      void flushExpired(double now);
+
+      MPI::Group group;
+      SendEngine *engine;
+      std::vector<Queue *> queue;
+      /*! when flushExpired() should next look at all batches */
+      std::atomic<double> nextExpiryCheck;
+    };
+
+    template<typename Func>
+    void TileBatch::forEachTile(const Func &func)
+    {
+      size_t ofs = 0;
+      while (ofs < numBytes) {
+        int64_t tileBytes;
+        memcpy(&tileBytes,data+ofs,sizeof(tileBytes));
+        ofs += sizeof(tileBytes);
+        if (tileBytes < 0 || ofs+tileBytes > numBytes)
+          throw std::runtime_error("corrupt tile batch");
+        CompressedTile tile(data+ofs,tileBytes,fromRank);
+        func(tile);
+        ofs += (tileBytes+7) & ~size_t(7);
+      }
+    }
+
+  } // ::ospray::dw
+} // ::ospray
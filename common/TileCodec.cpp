@@ -0,0 +1,299 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "TileCodec.h"
+#include "CompressedTile.h"
+
+#if TURBO_JPEG
+# include "turbojpeg.h"
+# define JPEG_QUALITY 100
+#endif
+
+namespace ospray {
+  namespace dw {
+
+    void packPixels(uint32_t *out, const PlainTile &tile)
+    {
+      const vec2i size = tile.size();
+      copyPixels(out,size.x,tile.pixel,tile.pitch,size);
+    }
+
+    void unpackPixels(PlainTile &tile, const uint32_t *in)
+    {
+      const vec2i size = tile.size();
+      copyPixels(tile.pixel,tile.pitch,in,size.x,size);
+    }
+
+    // =======================================================
+    // raw codec - plain copy of the tile's pixels
+    // =======================================================
+
+    struct RawCodec : public TileCodec {
+      virtual size_t maxEncodedSize(const vec2i &size) const override
+      { return size.product()*sizeof(uint32_t); }
+
+      virtual size_t encode(unsigned char *out, const PlainTile &tile) override
+      {
+        packPixels((uint32_t *)out,tile);
+        return tile.size().product()*sizeof(uint32_t);
+      }
+
+      virtual void decode(PlainTile &tile, const unsigned char *in, size_t numBytes) override
+      {
+        if (numBytes != tile.size().product()*sizeof(uint32_t))
+          throw std::runtime_error("raw codec: tile size mismatch");
+        unpackPixels(tile,(const uint32_t *)in);
+      }
+    };
+
+    TileCodec *createRawCodec() { return new RawCodec; }
+
+    // =======================================================
+    // solid codec - one color for the entire tile
+    // =======================================================
+
+    struct SolidCodec : public TileCodec {
+      virtual size_t maxEncodedSize(const vec2i &) const override
+      { return sizeof(uint32_t); }
+
+      virtual size_t encode(unsigned char *out, const PlainTile &tile) override
+      {
+        memcpy(out,tile.pixel,sizeof(uint32_t));
+        return sizeof(uint32_t);
+      }
+
+      virtual void decode(PlainTile &tile, const unsigned char *in, size_t numBytes) override
+      {
+        if (numBytes != sizeof(uint32_t))
+          throw std::runtime_error("solid codec: invalid tile");
+        uint32_t color;
+        memcpy(&color,in,sizeof(color));
+        const vec2i size = tile.size();
+        for (int iy=0;iy<size.y;iy++) {
+          uint32_t *out = tile.pixel + iy*tile.pitch;
+          std::fill(out,out+size.x,color);
+        }
+      }
+    };
+
+    TileCodec *createSolidCodec() { return new SolidCodec; }
+
+    // =======================================================
+    // 'unchanged' codec - header only, no pixels
+    // =======================================================
+
+    struct UnchangedCodec : public TileCodec {
+      virtual size_t maxEncodedSize(const vec2i &) const override
+      { return 0; }
+
+      virtual size_t encode(unsigned char *, const PlainTile &) override
+      { return 0; }
+
+      virtual void decode(PlainTile &, const unsigned char *, size_t) override
+      { throw std::runtime_error("'unchanged' tiles have to be resolved against the previous frame"); }
+    };
+
+    TileCodec *createUnchangedCodec() { return new UnchangedCodec; }
+
+    // =======================================================
+    // 'strided' codec - the pixels go in a separate message
+    // =======================================================
+
+    struct StridedCodec : public TileCodec {
+      virtual size_t maxEncodedSize(const vec2i &) const override
+      { return sizeof(int); }
+
+      virtual size_t encode(unsigned char *, const PlainTile &) override
+      { throw std::runtime_error("'strided' tiles have to be created with CompressedTile::encodeStrided()"); }
+
+      virtual void decode(PlainTile &, const unsigned char *, size_t) override
+      { throw std::runtime_error("'strided' tiles' pixels have to be received separately"); }
+    };
+
+    TileCodec *createStridedCodec() { return new StridedCodec; }
+
+    // =======================================================
+    // jpeg codec - lossy, via libjpeg-turbo
+    // =======================================================
+
+#if TURBO_JPEG
+    struct JPEGCodec : public TileCodec {
+      JPEGCodec()
+        : compressor(tjInitCompress()),
+          decompressor(tjInitDecompress()),
+          quality(JPEG_QUALITY),
+          subsampling(TJSAMP_444)
+      {}
+      virtual ~JPEGCodec()
+      {
+        tjDestroy(compressor);
+        tjDestroy(decompressor);
+      }
+
+      virtual size_t maxEncodedSize(const vec2i &size) const override
+      { return tjBufSize(size.x,size.y,TJSAMP_444); }
+
+      virtual size_t encode(unsigned char *out, const PlainTile &tile) override
+      {
+        unsigned char *jpegBuffer = out;
+        unsigned long jpegSize = maxEncodedSize(tile.size());
+        int rc = tjCompress2(compressor,(unsigned char *)tile.pixel,
+                             tile.size().x,tile.pitch*sizeof(int),tile.size().y,
+                             TJPF_RGBX,&jpegBuffer,&jpegSize,subsampling,quality,
+                             TJFLAG_NOREALLOC);
+        if (rc != 0)
+          throw std::runtime_error(std::string("jpeg codec: ")+tjGetErrorStr());
+        return jpegSize;
+      }
+
+      virtual void decode(PlainTile &tile, const unsigned char *in, size_t numBytes) override
+      {
+        const vec2i size = tile.size();
+        int rc = tjDecompress2(decompressor,(unsigned char *)in,numBytes,
+                               (unsigned char*)tile.pixel,
+                               size.x,tile.pitch*sizeof(int),size.y,
+                               TJPF_RGBX,0);
+        if (rc != 0)
+          throw std::runtime_error(std::string("jpeg codec: ")+tjGetErrorStr());
+      }
+
+      virtual void setQuality(int quality) override
+      { this->quality = std::max(1,std::min(100,quality)); }
+
+      virtual void setChromaSubsampling(ChromaSubsampling subsampling) override
+      {
+        switch (subsampling) {
+        case CHROMA_422: this->subsampling = TJSAMP_422; break;
+        case CHROMA_420: this->subsampling = TJSAMP_420; break;
+        default:         this->subsampling = TJSAMP_444; break;
+        }
+      }
+
+      tjhandle compressor;
+      tjhandle decompressor;
+      int      quality;
+      /*! TJSAMP_xyz */
+      int      subsampling;
+    };
+
+    TileCodec *createJPEGCodec() { return new JPEGCodec; }
+#else
+    TileCodec *createJPEGCodec()
+    { throw std::runtime_error("jpeg codec not available (build with USE_TURBO_JPEG)"); }
+#endif
+
+    // =======================================================
+    // codec registry
+    // =======================================================
+
+    static const char *codecNames[CODEC_COUNT] = { "raw", "lz", "qoi", "jpeg", "solid", "unchanged", "delta", "strided" };
+
+    TileCodec *TileCodec::create(CodecType type)
+    {
+      switch (type) {
+      case CODEC_RAW:       return createRawCodec();
+      case CODEC_LZ:        return createLZCodec();
+      case CODEC_QOI:       return createQOICodec();
+      case CODEC_JPEG:      return createJPEGCodec();
+      case CODEC_SOLID:     return createSolidCodec();
+      case CODEC_UNCHANGED: return createUnchangedCodec();
+      case CODEC_DELTA:     return createDeltaCodec();
+      case CODEC_STRIDED:   return createStridedCodec();
+      default:
+        throw std::runtime_error("invalid tile codec type");
+      }
+    }
+
+    bool TileCodec::isAvailable(CodecType type)
+    {
+#if !TURBO_JPEG
+      if (type == CODEC_JPEG) return false;
+#endif
+      return type >= 0 && type < CODEC_COUNT;
+    }
+
+    bool TileCodec::isLossless(CodecType type)
+    {
+      return type != CODEC_JPEG;
+    }
+
+    bool TileCodec::isSelectable(CodecType type)
+    {
+      switch (type) {
+      case CODEC_RAW:
+      case CODEC_LZ:
+      case CODEC_QOI:
+      case CODEC_JPEG:
+      case CODEC_STRIDED:
+        return true;
+      default:
+        return false;
+      }
+    }
+
+    const char *TileCodec::nameOf(CodecType type)
+    {
+      if (type < 0 || type >= CODEC_COUNT)
+        return "<invalid codec>";
+      return codecNames[type];
+    }
+
+    CodecType TileCodec::typeOf(const std::string &name)
+    {
+      for (int i=0;i<CODEC_COUNT;i++)
+        if (name == codecNames[i])
+          return (CodecType)i;
+      throw std::runtime_error("unknown tile codec '"+name+"'");
+    }
+
+    CodecType TileCodec::defaultType()
+    {
+#if TURBO_JPEG
+      return CODEC_JPEG;
+#else
+      return CODEC_RAW;
+#endif
+    }
+
+    CodecSet::CodecSet()
+    {
+      for (int i=0;i<CODEC_COUNT;i++)
+        codec[i] = NULL;
+    }
+
+    CodecSet::~CodecSet()
+    {
+      for (int i=0;i<CODEC_COUNT;i++)
+        delete codec[i];
+    }
+
+    TileCodec *CodecSet::get(CodecType type)
+    {
+      if (type < 0 || type >= CODEC_COUNT)
+        throw std::runtime_error("invalid tile codec type");
+      if (!codec[type])
+        codec[type] = TileCodec::create(type);
+      return codec[type];
+    }
+
+  } // ::ospray::dw
+} // ::ospray
@@ -0,0 +1,173 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "ospcommon/box.h"
+#include "PixelKernels.h"
+#include <string>
+#include <vector>
+
+namespace ospray {
+  namespace dw {
+
+    using namespace ospcommon;
+
+    struct PlainTile;
+
+    /*! the different ways a tile's pixels can be encoded. the codec
+        type gets stored in every tile's header, so a receiver can
+        decode tiles of different codecs within the same frame. Note
+        these values go over the wire, so only ever append new
+        codecs at the end */
+    typedef enum {
+      /*! plain copy of all pixels, no compression at all */
+      CODEC_RAW = 0,
+      /*! fast, lossless, byte-oriented LZ77 codec (LZ4 block format) */
+      CODEC_LZ,
+      /*! fast, lossless, image-aware codec (QOI-style pixel ops) */
+      CODEC_QOI,
+      /*! lossy turbo-jpeg; only available if built with USE_TURBO_JPEG */
+      CODEC_JPEG,
+      /*! a single color for the entire tile; only valid for tiles
+          whose pixels all have the same value */
+      CODEC_SOLID,
+      /*! no pixels at all: the tile's region has the same content as
+          in the previous frame. Receivers have to resolve this
+          against their previous frame themselves; the codec's
+          decode() will throw */
+      CODEC_UNCHANGED,
+      /*! lossless residual against the same region in the previous
+          frame (see subtractPixels()); receivers have to add the
+          decoded residual to their previous frame's pixels */
+      CODEC_DELTA,
+      /*! plain copy of all pixels, like CODEC_RAW, but the pixels
+          don't go into the tile: they get sent as a message of their
+          own, so they never get copied into (or batched with) other
+          tiles, and the receiver turns the tile back into a raw one
+          as that message comes in (see
+          CompressedTile::encodeStrided()). The tile only carries
+          that message's tag; the codec's encode() and decode() will
+          throw */
+      CODEC_STRIDED,
+      CODEC_COUNT
+    } CodecType;
+
+    /*! chroma subsampling for lossy codecs, from best to worst quality */
+    typedef enum {
+      CHROMA_444 = 0,
+      CHROMA_422,
+      CHROMA_420
+    } ChromaSubsampling;
+
+    /*! abstract interface for a tile codec. codecs may carry internal
+        state (scratch memory, jpeg handles, ...), so an instance must
+        only ever be used by one thread at a time - see CodecSet */
+    struct TileCodec {
+      virtual ~TileCodec() {}
+
+      /*! upper bound for the number of bytes that 'encode' may write
+          for a tile of given size */
+      virtual size_t maxEncodedSize(const vec2i &size) const = 0;
+
+      /*! encode the given tile's pixels into 'out' (which has to
+          have at least maxEncodedSize() bytes), and return the
+          number of bytes actually written */
+      virtual size_t encode(unsigned char *out, const PlainTile &tile) = 0;
+
+      /*! decode 'numBytes' of encoded data into the given tile; the
+          tile's region has to already be set, and its pixel buffer
+          has to be large enough to hold it (at the tile's pitch) */
+      virtual void decode(PlainTile &tile, const unsigned char *in, size_t numBytes) = 0;
+
+      /*! set quality (1..100) for subsequent encodes; ignored by all
+          lossless codecs */
+      virtual void setQuality(int) {}
+      /*! set chroma subsampling for subsequent encodes; ignored by
+          all lossless codecs */
+      virtual void setChromaSubsampling(ChromaSubsampling) {}
+
+      /*! create a new instance of given codec type; throws a
+          std::runtime_error if this codec is not available in this
+          build */
+      static TileCodec *create(CodecType type);
+
+      /*! returns whether the given codec is available in this build */
+      static bool isAvailable(CodecType type);
+
+      /*! returns whether the given codec reproduces pixels exactly */
+      static bool isLossless(CodecType type);
+
+      /*! returns whether clients may pick the given codec for all of
+          their tiles (see Client::setCodec()); the others ('solid',
+          'unchanged', and 'delta') only ever get picked per tile,
+          internally */
+      static bool isSelectable(CodecType type);
+
+      /*! return the human-readable name of given codec type */
+      static const char *nameOf(CodecType type);
+
+      /*! find the codec of the given name ('raw', 'lz', 'qoi',
+          'jpeg', 'solid', 'unchanged', 'delta', 'strided'); throws a
+          std::runtime_error if unknown */
+      static CodecType typeOf(const std::string &name);
+
+      /*! the codec to use if the user didn't specify any: jpeg if
+          available, raw otherwise */
+      static CodecType defaultType();
+    };
+
+    /*! one instance of each codec, created on demand. Since codecs
+        can carry state every thread that en- or de-codes tiles should
+        use its own set */
+    struct CodecSet {
+      CodecSet();
+      ~CodecSet();
+
+      /*! get (and if required, create) the codec of given type */
+      TileCodec *get(CodecType type);
+
+    private:
+      TileCodec *codec[CODEC_COUNT];
+    };
+
+    /*! copy the tile's (pitched) pixels into a dense, linear array
+        of region.size().product() pixels */
+    void packPixels(uint32_t *out, const PlainTile &tile);
+    /*! copy a dense, linear array of pixels into the tile's (pitched)
+        pixel buffer */
+    void unpackPixels(PlainTile &tile, const uint32_t *in);
+
+    /*! @{ the individual codecs, in LZCodec.cpp, QOICodec.cpp,
+        DeltaCodec.cpp, and TileCodec.cpp, respectively */
+    TileCodec *createRawCodec();
+    TileCodec *createLZCodec();
+    TileCodec *createQOICodec();
+    TileCodec *createJPEGCodec();
+    TileCodec *createSolidCodec();
+    TileCodec *createUnchangedCodec();
+    TileCodec *createDeltaCodec();
+    TileCodec *createStridedCodec();
+    /*! @} */
+
+  } // ::ospray::dw
+} // ::ospray
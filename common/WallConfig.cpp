@@ -130,6 +130,45 @@ namespace ospray {
     }
 
 
+    /*! with several head nodes, each head node dispatches to its own
+        rectangular block of displays; this returns the range of
+        displays that the given head node is responsible for */
+    box2i  WallConfig::displaysOfHeadNode(int headNode, int numHeadNodes) const
+    {
+      /* pick the grid of blocks with the smallest (and, among those,
+         the most square) blocks */
+      vec2i grid(0);
+      vec2i bestBlock(0);
+      for (int gx=1;gx<=numHeadNodes;gx++) {
+        if (numHeadNodes % gx) continue;
+        const int gy = numHeadNodes / gx;
+        if (gx > numDisplays.x || gy > numDisplays.y) continue;
+        const vec2i block = divRoundUp(numDisplays,vec2i(gx,gy));
+        if (grid.x == 0
+            || block.product() < bestBlock.product()
+            || (block.product() == bestBlock.product()
+                && abs(block.x-block.y) < abs(bestBlock.x-bestBlock.y))) {
+          grid = vec2i(gx,gy);
+          bestBlock = block;
+        }
+      }
+      if (grid.x == 0)
+        throw std::runtime_error("cannot split the displays into one block per head node");
+
+      const vec2i blockID(headNode % grid.x, headNode / grid.x);
+      return box2i(blockID*numDisplays/grid,
+                   (blockID+vec2i(1))*numDisplays/grid);
+    }
+
+    /*! the pixel region covered by the displays of given head node
+        (without the bezels around that block of displays) */
+    box2i  WallConfig::regionOfHeadNode(int headNode, int numHeadNodes) const
+    {
+      const box2i displays = displaysOfHeadNode(headNode,numHeadNodes);
+      return box2i(regionOfDisplay(displays.lower).lower,
+                   regionOfDisplay(displays.upper-vec2i(1)).upper);
+    }
+
     /*! return the pixel region in the global display wall space that
         display at given coordinates is covering */
     box2i  WallConfig::regionOfDisplay(const vec2i &displayID) const
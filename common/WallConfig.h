@@ -85,6 +85,16 @@ namespace ospray {
           that pixel region */
       box2i  affectedDisplays(const box2i &pixelRegion) const;
 
+      /*! with several head nodes, each head node dispatches to its
+          own rectangular block of displays; this returns the range
+          of displays that the given head node is responsible for
+          (blocks are as close to square as the display and head
+          node counts allow) */
+      box2i  displaysOfHeadNode(int headNode, int numHeadNodes) const;
+      /*! the pixel region covered by the displays of given head node
+          (without the bezels around that block of displays) */
+      box2i  regionOfHeadNode(int headNode, int numHeadNodes) const;
+
       void   print() const;
       inline bool doStereo() const { return stereo; }
 
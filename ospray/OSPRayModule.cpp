@@ -151,6 +151,22 @@ namespace ospray {
         std::cout << "#osp:dw: trying to establish connection to display wall service at MPI port " << streamName << std::endl;
 
         client = new dw::Client(mpicommon::worker.comm,streamName);
+
+        std::string codecName = getParamString("codec","");
+        if (codecName == "auto")
+          client->setAdaptiveCodec(true);
+        else if (!codecName.empty())
+          client->setCodec(TileCodec::typeOf(codecName));
+        client->setQuality(getParam1i("quality",100));
+        client->setSkipUnchangedTiles(getParam1i("skipUnchanged",0));
+        client->setDeltaEncoding(getParam1i("deltaEncoding",0));
+        client->setKeyFrameInterval(getParam1i("keyFrameInterval",0));
+        client->setTargetFrameRate(getParam1f("targetFrameRate",0.f),
+                                   getParam1f("linkBudget",0.f)*1e6);
+        client->setMaxBatchSize(size_t(std::max(0,getParam1i("batchSize",256)))*1024);
+        client->setSendLimits(getParam1i("maxSendsInFlight",64),
+                              size_t(std::max(0,getParam1i("sendBacklog",64)))<<20);
+        client->setMaxFramesInFlight(getParam1i("framesInFlight",1));
       }
 
       //! \brief create an instance of this pixel op
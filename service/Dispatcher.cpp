@@ -21,8 +21,16 @@
 */
 
 #include "../common/MPI.h"
-#include "../common/CompressedTile.h"
+#include "../common/ReceiveEngine.h"
+#include "../common/SendEngine.h"
 #include "../common/WallConfig.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace ospray {
   namespace dw {
@@ -32,60 +40,235 @@ namespace ospray {
     using std::flush;
 
     /*! the dispatcher that receives tiles on the head node, and then
-      dispatches them to the actual tile receivers */
+      dispatches them to the actual tile receivers. With several head
+      nodes, each one only gets (and forwards) the tiles for its own
+      block of displays. With 'transcode', tiles that straddle
+      displays (or bezels) get decoded, cropped to each display, and
+      re-encoded, instead of being sent to every display as a whole */
     void runDispatcher(const MPI::Group &outsideClients,
                        const MPI::Group &displayGroup,
-                       const WallConfig &wallConfig)
+                       const WallConfig &wallConfig,
+                       const box2i &displayBlock,
+                       bool transcode,
+                       int numForwardingThreads)
     {
       // std::thread *dispatcherThread = new std::thread([=]() {
-      std::cout << "#osp:dw(hn): running dispatcher on rank 0" << std::endl;
+      std::cout << "#osp:dw(hn): running dispatcher for displays "
+                << displayBlock << ", with " << numForwardingThreads
+                << " forwarding thread(s)" << std::endl;
 
-      size_t numWrittenThisFrame = 0;
-      size_t numExpectedThisFrame = wallConfig.totalPixelCount();
+      /* count only pixels that actually land on one of our displays
+         (which is what the displays count, too); tiles may or may
+         not have been cropped to display regions by the client */
+      const size_t numExpectedPerFrame
+        = displayBlock.size().product()*wallConfig.displayPixelCount();
+      /* clients may run ahead, so tiles of several frames can be in
+         flight; count per frame */
+      std::map<int,size_t> numWritten;
+      int lastCompletedFrame = -1;
 
-      while (1) {
-        CompressedTile encoded;
-        DW_DBG(printf("dispatcher trying to receive...\n"));
-        encoded.receiveOne(outsideClients);
+      /* once a frame is complete (and sent), this thread waits
+         for the displays to complete it, too, and then releases the
+         clients; the displays come first, since they only have room
+         for so many frames in flight. Meanwhile, we keep forwarding
+         the next frames' tiles */
+      std::mutex frameMutex;
+      std::condition_variable frameCompleted;
+      std::deque<int> completedFrames;
+      std::thread completionThread([&]() {
+          while (1) {
+            {
+              std::unique_lock<std::mutex> lock(frameMutex);
+              frameCompleted.wait(lock,[&]() { return !completedFrames.empty(); });
+              completedFrames.pop_front();
+            }
+            /* non-blocking barriers, to match what the displays and
+               clients do */
+            MPI_Request displaysDone = displayGroup.ibarrier();
+            MPI_CALL(Wait(&displaysDone,MPI_STATUS_IGNORE));
+            MPI_Request clientsDone = outsideClients.ibarrier();
+            MPI_CALL(Wait(&clientsDone,MPI_STATUS_IGNORE));
+          }
+        });
+
+      /* incoming batches get forwarded by 'numForwardingThreads'
+         threads of their own (they never return, so they can't run
+         as tasks); each display gets the tiles it needs from a batch as one message,
+         sent straight out of the received batch's memory (no copies,
+         and one pending send per display, so a slow display doesn't
+         hold up the others) */
+      ReceiveEngine receiver(outsideClients);
+      SendEngine    sender(displayGroup);
+
+      /*! when transcoding, lossy tiles get re-encoded with the
+          quality and chroma subsampling the client encoded them with
+          - but with no more than this quality while the sends to the
+          displays are backing up */
+#define TRANSCODE_CONGESTED_QUALITY 50
+
+      auto forwardLoop = [&]() {
+          TileBatch incoming;
+          /* the received batch's tiles for each display rank */
+          std::vector<TileRanges> tilesFor(displayGroup.size);
+          std::vector<std::pair<int,TileRanges>> parts;
+          /* the transcoded crops for each display rank */
+          std::vector<TileBatch> cropsFor(transcode ? displayGroup.size : 0);
+          /* pixels forwarded (per frame) from the current batch */
+          std::vector<std::pair<int,size_t>> written;
+          /* the parts of the current tile that are visible on some
+             display, and the display's rank */
+          std::vector<std::pair<box2i,int>> visibleParts;
+          CodecSet       codecs;
+          CompressedTile crop;
+          while (1) {
+            DW_DBG(printf("dispatcher trying to receive...\n"));
+            receiver.receive(incoming);
 
-        const box2i region = encoded.getRegion();
+            const int maxLossyQuality
+              = (sender.backlogBytes() > sender.maxBacklogBytes/2)
+              ? TRANSCODE_CONGESTED_QUALITY
+              : 100;
+
+            incoming.forEachTile([&](CompressedTile &encoded) {
+                const box2i region = encoded.getRegion();
         
-        // -------------------------------------------------------
-        // compute displays affected by this tile
-        // -------------------------------------------------------
-        const box2i affectedDisplays = wallConfig.affectedDisplays(region);
+                // -------------------------------------------------------
+                // compute displays affected by this tile
+                // -------------------------------------------------------
+                const box2i affectedDisplays
+                  = intersectionOf(wallConfig.affectedDisplays(region),displayBlock);
         
-        DW_DBG(printf("region %i %i - %i %i displays %i %i - %i %i\n",
-                      region.lower.x,
-                      region.lower.y,
-                      region.upper.x,
-                      region.upper.y,
-                      affectedDisplays.lower.x,
-                      affectedDisplays.lower.y,
-                      affectedDisplays.upper.x,
-                      affectedDisplays.upper.y));
-
-        // -------------------------------------------------------
-        // now, send to all affected displays ...
-        // -------------------------------------------------------
-        for (int dy=affectedDisplays.lower.y;dy<affectedDisplays.upper.y;dy++)
-          for (int dx=affectedDisplays.lower.x;dx<affectedDisplays.upper.x;dx++) {
-            DW_DBG(printf("sending to %i/%i -> %i\n",dx,dy,wallConfig.rankOfDisplay(vec2i(dx,dy))));
-            encoded.sendTo(displayGroup,wallConfig.rankOfDisplay(vec2i(dx,dy)));
-          }
+                DW_DBG(printf("region %i %i - %i %i displays %i %i - %i %i\n",
+                              region.lower.x,
+                              region.lower.y,
+                              region.upper.x,
+                              region.upper.y,
+                              affectedDisplays.lower.x,
+                              affectedDisplays.lower.y,
+                              affectedDisplays.upper.x,
+                              affectedDisplays.upper.y));
 
-        numWrittenThisFrame += region.size().product();
-        DW_DBG(printf("dispatch %i/%i\n",numWrittenThisFrame,numExpectedThisFrame));
-        if (numWrittenThisFrame == numExpectedThisFrame) {
-          DW_DBG(printf("#osp:dw(hn): head node has a full frame\n"));
-          outsideClients.barrier();
-          displayGroup.barrier();
+                visibleParts.clear();
+                size_t numPixels = 0;
+                for (int dy=affectedDisplays.lower.y;dy<affectedDisplays.upper.y;dy++)
+                  for (int dx=affectedDisplays.lower.x;dx<affectedDisplays.upper.x;dx++) {
+                    const vec2i displayID(dx,dy);
+                    const box2i visible
+                      = intersectionOf(region,wallConfig.regionOfDisplay(displayID));
+                    const vec2i visibleSize = visible.size();
+                    if (visibleSize.x <= 0 || visibleSize.y <= 0)
+                      // only covers this display's bezel
+                      continue;
+                    visibleParts.push_back(std::make_pair(visible,
+                                                          wallConfig.rankOfDisplay(displayID)));
+                    numPixels += visibleSize.product();
+                  }
 
-          numWrittenThisFrame = 0;
-        }
-        
-      };
-      // });
+                const int frameID = encoded.getFrameID();
+                if (!written.empty() && written.back().first == frameID)
+                  written.back().second += numPixels;
+                else
+                  written.push_back(std::make_pair(frameID,numPixels));
+
+                const bool straddling
+                  = visibleParts.size() > 1
+                  || numPixels < size_t(region.size().product());
+                if (!transcode || !straddling) {
+                  // -------------------------------------------------------
+                  // forward the tile as is to all affected displays ...
+                  // -------------------------------------------------------
+                  for (auto &part : visibleParts)
+                    tilesFor[part.second].add(incoming,encoded);
+                  return;
+                }
+
+                // -------------------------------------------------------
+                // ... or crop it to each display, and re-encode the
+                // crops, so no display has to decode pixels it doesn't
+                // show
+                // -------------------------------------------------------
+                const CodecType codec = encoded.getCodec();
+                if (codec == CODEC_UNCHANGED) {
+                  /* no pixels to decode; the crops are just headers
+                     (and the codec never looks at the pixels) */
+                  uint32_t noPixels = 0;
+                  for (auto &part : visibleParts) {
+                    PlainTile cropped(&noPixels,0,encoded.getEye());
+                    cropped.region = part.first;
+                    crop.encode(codecs,codec,cropped);
+                    crop.setFrameID(frameID);
+                    cropsFor[part.second].append(crop);
+                  }
+                  return;
+                }
+
+                /* lossless crops are exact; lossy ones lose a bit
+                   more, so we never go above what the client chose */
+                const int quality = std::min(encoded.getQuality(),maxLossyQuality);
+                const ChromaSubsampling subsampling = encoded.getSubsampling();
+                PlainTile decoded(region.size());
+                encoded.decode(codecs,decoded);
+                for (auto &part : visibleParts) {
+                  const box2i &visible = part.first;
+                  const int ofs
+                    = (visible.lower.x-region.lower.x)
+                    + decoded.pitch * (visible.lower.y-region.lower.y);
+                  PlainTile cropped(decoded.pixel+ofs,decoded.pitch,decoded.eye);
+                  cropped.region = visible;
+                  /* solid and delta crops stay solid and delta tiles,
+                     respectively (a delta tile's pixels are residuals) */
+                  crop.encode(codecs,codec,cropped,quality,subsampling);
+                  if (crop.numBytes >= encoded.numBytes) {
+                    /* cropping didn't make it any smaller (which
+                       lossy codecs are prone to); the display might
+                       as well get the original */
+                    tilesFor[part.second].add(incoming,encoded);
+                    continue;
+                  }
+                  crop.setFrameID(frameID);
+                  cropsFor[part.second].append(crop);
+                }
+              });
+
+            // -------------------------------------------------------
+            // ... and send each display its tiles
+            // -------------------------------------------------------
+            for (int rank=0;rank<(int)tilesFor.size();rank++)
+              if (!tilesFor[rank].empty()) {
+                parts.push_back(std::make_pair(rank,tilesFor[rank]));
+                tilesFor[rank].clear();
+              }
+            if (!parts.empty())
+              sender.send(incoming,parts);
+            parts.clear();
+            for (int rank=0;rank<(int)cropsFor.size();rank++)
+              if (!cropsFor[rank].empty())
+                sender.send(cropsFor[rank],rank);
+
+            /* only count the pixels once their sends are queued: once
+               a frame is complete, all of its tiles have to be on
+               their way before the completion thread enters the
+               barrier with the displays */
+            std::lock_guard<std::mutex> lock(frameMutex);
+            for (auto &w : written)
+              numWritten[w.first] += w.second;
+            written.clear();
+            while (numWritten[lastCompletedFrame+1] == numExpectedPerFrame) {
+              DW_DBG(printf("#osp:dw(hn): head node has a full frame\n"));
+              numWritten.erase(++lastCompletedFrame);
+              sender.postAll();
+              completedFrames.push_back(lastCompletedFrame);
+              frameCompleted.notify_one();
+            }
+          }
+        };
+
+      std::vector<std::thread> forwardingThreads;
+      for (int i=0;i<numForwardingThreads;i++)
+        forwardingThreads.push_back(std::thread(forwardLoop));
+      for (auto &thread : forwardingThreads)
+        thread.join();
+      completionThread.join();
     }
 
     
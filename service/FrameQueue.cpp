@@ -0,0 +1,91 @@
+/* 
+Copyright (c) 2016 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "FrameQueue.h"
+#include <stdexcept>
+
+namespace ospray {
+  namespace dw {
+
+    FrameQueue::FrameQueue(int numFrames, const vec2i &size, bool stereo)
+      : frames(numFrames),
+        latest(nullptr),
+        numDropped(0)
+    {
+      const size_t numPixels = size.product();
+      for (auto &frame : frames) {
+        frame = new Frame;
+        frame->pixel_l = new uint32_t[numPixels];
+        if (stereo)
+          frame->pixel_r = new uint32_t[numPixels];
+      }
+    }
+
+    FrameQueue::~FrameQueue()
+    {
+      for (auto frame : frames) {
+        delete[] frame->pixel_l;
+        delete[] frame->pixel_r;
+        delete frame;
+      }
+    }
+
+    Frame *FrameQueue::acquire()
+    {
+      for (auto frame : frames) {
+        int unused = 0;
+        if (frame->refCount.compare_exchange_strong(unused,1))
+          return frame;
+      }
+      throw std::runtime_error("no free frame buffer");
+    }
+
+    void FrameQueue::addRef(Frame *frame)
+    {
+      assert(frame->refCount > 0);
+      ++frame->refCount;
+    }
+
+    void FrameQueue::release(Frame *frame)
+    {
+      assert(frame->refCount > 0);
+      --frame->refCount;
+    }
+
+    void FrameQueue::publish(Frame *frame)
+    {
+      addRef(frame);
+      frame->numDroppedBefore = numDropped;
+      Frame *dropped = latest.exchange(frame);
+      if (dropped) {
+        ++numDropped;
+        release(dropped);
+      }
+    }
+
+    Frame *FrameQueue::takeLatest()
+    {
+      return latest.exchange(nullptr);
+    }
+
+  } // ::ospray::dw
+} // ::ospray
@@ -0,0 +1,92 @@
+/* 
+Copyright (c) 2016 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "ospcommon/box.h"
+#include <atomic>
+#include <vector>
+
+namespace ospray {
+  namespace dw {
+
+    using namespace ospcommon;
+
+    /*! one frame buffer (left and, in stereo, right eye) of a display */
+    struct Frame {
+      /*! the frame that currently lives in this buffer */
+      int       frameID { -1 };
+      uint32_t *pixel_l { nullptr };
+      uint32_t *pixel_r { nullptr };
+      /*! number of frames that got dropped (ie, never shown) before
+          this one got published */
+      size_t    numDroppedBefore { 0 };
+      /*! number of owners (assembly slot, queue, presenter); 0 means
+          the buffer is unused */
+      std::atomic<int> refCount { 0 };
+    };
+
+    /*! a fixed set of frame buffers, shared between the tile
+        receivers (which assemble frames in them) and the presenter
+        (which displays them), without any locks: frames are
+        reference-counted, and only ever get re-used once nobody
+        references them any more - so the presenter never shows a
+        frame that is being overwritten. Completed frames get
+        published; if the presenter hasn't taken the last one yet,
+        that one gets dropped (latest frame wins), so the receivers
+        never have to wait for the presenter */
+    struct FrameQueue {
+      FrameQueue(int numFrames, const vec2i &size, bool stereo);
+      ~FrameQueue();
+
+      /*! get an unused frame buffer, with one reference; throws a
+          std::runtime_error if all are in use (the queue has to have
+          enough frames for every frame in flight, plus the one that
+          is published, plus the one that is being displayed) */
+      Frame *acquire();
+      void addRef(Frame *frame);
+      void release(Frame *frame);
+
+      /*! make the given (completed) frame the latest one; the queue
+          takes its own reference */
+      void publish(Frame *frame);
+      /*! take the latest published frame, if any has been published
+          since the last call (NULL otherwise); the caller takes over
+          the queue's reference, and has to release() it once done */
+      Frame *takeLatest();
+
+      /*! count a frame that never got published (because a later
+          frame superseded it before it was even assembled) */
+      void countDropped() { ++numDropped; }
+      /*! number of frames that never got shown: the ones counted
+          via countDropped(), plus the ones that got replaced by a
+          later one before the presenter took them */
+      size_t numDroppedFrames() const { return numDropped; }
+
+    private:
+      std::vector<Frame *> frames;
+      std::atomic<Frame *> latest;
+      std::atomic<size_t>  numDropped;
+    };
+
+  } // ::ospray::dw
+} // ::ospray
@@ -79,18 +79,24 @@ namespace ospray {
 
     /*! send the display wall config to the client, so the client will
         known both display arrayngement and total frame buffer
-        config */
+        config; with head nodes, also tell it which pixel region each
+        head node is responsible for */
     void sendConfigToClient(const MPI::Group &outside, 
                             const MPI::Group &me,
-                            const WallConfig &wallConfig)
+                            const WallConfig &wallConfig,
+                            int maxFramesInFlight,
+                            int numHeadNodes,
+                            bool putFrames,
+                            bool sharedMemoryTiles,
+                            bool exchangeFrames)
     {
       vec2i numDisplays = wallConfig.numDisplays;
       vec2i pixelsPerDisplay = wallConfig.pixelsPerDisplay;
       vec2f relativeBezelWidth = wallConfig.relativeBezelWidth;
       int arrangement = wallConfig.displayArrangement;
       int stereo      = wallConfig.stereo;
-      /*! if we're the head node, let's 'fake' a single display to the client */
-      if (me.size == 1) {
+      /*! if we're the head node(s), let's 'fake' a single display to the client */
+      if (numHeadNodes > 0) {
         pixelsPerDisplay = wallConfig.totalPixels();
         numDisplays = vec2i(1);
         relativeBezelWidth = vec2f(0.f);
@@ -105,6 +111,29 @@ namespace ospray {
                      me.rank==0?MPI_ROOT:MPI_PROC_NULL,outside.comm));
       MPI_CALL(Bcast(&stereo,1,MPI_INT,
                      me.rank==0?MPI_ROOT:MPI_PROC_NULL,outside.comm));
+      MPI_CALL(Bcast(&maxFramesInFlight,1,MPI_INT,
+                     me.rank==0?MPI_ROOT:MPI_PROC_NULL,outside.comm));
+      MPI_CALL(Bcast(&numHeadNodes,1,MPI_INT,
+                     me.rank==0?MPI_ROOT:MPI_PROC_NULL,outside.comm));
+      std::vector<box2i> headNodeRegions(numHeadNodes);
+      for (int i=0;i<numHeadNodes;i++)
+        headNodeRegions[i] = wallConfig.regionOfHeadNode(i,numHeadNodes);
+      MPI_CALL(Bcast(headNodeRegions.data(),4*numHeadNodes,MPI_INT,
+                     me.rank==0?MPI_ROOT:MPI_PROC_NULL,outside.comm));
+      /* with putFrames, the number of frames each display's receive
+         buffers have room for (see FrameWindow); 0 otherwise */
+      int numWindowSlots = putFrames ? maxFramesInFlight+1 : 0;
+      MPI_CALL(Bcast(&numWindowSlots,1,MPI_INT,
+                     me.rank==0?MPI_ROOT:MPI_PROC_NULL,outside.comm));
+      /* whether to set up shared memory rings with co-located
+         clients next (see ShmTileRing::connect()) */
+      int sharedMemory = sharedMemoryTiles;
+      MPI_CALL(Bcast(&sharedMemory,1,MPI_INT,
+                     me.rank==0?MPI_ROOT:MPI_PROC_NULL,outside.comm));
+      /* whether to send tiles through a FrameExchange */
+      int exchange = exchangeFrames;
+      MPI_CALL(Bcast(&exchange,1,MPI_INT,
+                     me.rank==0?MPI_ROOT:MPI_PROC_NULL,outside.comm));
     }
 
     /*! open an MPI port and wait for the client(s) to connect to this
@@ -141,7 +170,9 @@ namespace ospray {
       if (outwardFacingGroup.rank == 0) {
         printf("communication established...\n");
       }
-      sendConfigToClient(MPI::Group(outside),outwardFacingGroup,wallConfig);
+      sendConfigToClient(MPI::Group(outside),outwardFacingGroup,wallConfig,
+                         maxFramesInFlight,numHeadNodes,putFrames,
+                         sharedMemoryTiles,exchangeFrames);
 
       outwardFacingGroup.barrier();
 
@@ -149,31 +180,39 @@ namespace ospray {
       return MPI::Group(outside);
     };
     
-    /*! allocate the frame buffers for left/right eye and recv/display, respectively */
+    /*! allocate the frame buffers for all frame slots */
     void Server::allocateFrameBuffers()
     {
-      assert(recv_l == NULL);
-      assert(disp_l == NULL);
-      assert(recv_r == NULL);
-      assert(disp_r == NULL);
+      assert(frameSlots.empty());
 
-      // // me.barrier();
-      // if (outsdide.rank == 0)
-      //   printf("#osp:dw: allocating frame buffers of %ix%i pixels\n",
-      //          wallConfig.pixelsPerDisplay.x,wallConfig.pixelsPerDisplay.y);
-      // // me.barrier();
+      /* (slots can't be moved, so no resize()) */
+      frameSlots = std::vector<FrameSlot>(maxFramesInFlight+1);
+      frameQueue = new FrameQueue(frameSlots.size()+2,
+                                  wallConfig.pixelsPerDisplay,
+                                  wallConfig.stereo);
+    }
 
-      const int pixelsPerBuffer = wallConfig.pixelsPerDisplay.product();
-      recv_l = new uint32_t[pixelsPerBuffer];
-      disp_l = new uint32_t[pixelsPerBuffer];
-      if (wallConfig.stereo) {
-        recv_r = new uint32_t[pixelsPerBuffer];
-        disp_r = new uint32_t[pixelsPerBuffer];
+    Server::FrameSlot &Server::slotOf(int frameID)
+    {
+      const int numSlots = frameSlots.size();
+      FrameSlot &slot = frameSlots[((frameID % numSlots) + numSlots) % numSlots];
+      if (slot.frameID != frameID) {
+        /* clients never run more than maxFramesInFlight frames
+           ahead, so whatever was in this slot before is neither in
+           flight nor the reference for one */
+        assert(slot.frameID < 0 || slot.frameID < lastCompletedFrame);
+        assert(slot.pending.empty());
+        if (slot.frame)
+          frameQueue->release(slot.frame);
+        slot.frame      = frameQueue->acquire();
+        slot.frame->frameID = frameID;
+        slot.numWritten = 0;
+        slot.numPending = 0;
+        slot.selfContained = true;
+        slot.dropped    = false;
+        slot.frameID.store(frameID,std::memory_order_release);
       }
-      // me.barrier();
-      // if (me.rank == 0)
-      //   printf("#osp:dw: frame buffers allocated (across all ranks)\n");
-      // me.barrier();
+      return slot;
     }
 
     /*! in dispather.cpp - the dispatcher that receives tiles on the
@@ -181,7 +220,10 @@ namespace ospray {
         receivers */
     void runDispatcher(const MPI::Group &outside,
                        const MPI::Group &displays,
-                       const WallConfig &wallConfig);
+                       const WallConfig &wallConfig,
+                       const box2i &displayBlock,
+                       bool transcode,
+                       int numForwardingThreads);
 
           // setupCommunications(this->wallConfig,
           //                     this->hasHeadNode,
@@ -201,18 +243,19 @@ namespace ospray {
          node. if no head node is used the dispatcher comm is a
          COMM_NULL */
 
-      // intercomm to the dispatcher, if this is a display node;
-      // intracomm containing onyl the dispatche3r node if one exists,
+      // intercomm to the dispatcher(s), if this is a display node;
+      // intracomm containing only the dispatcher nodes if any exist,
       // or invalid if we're not running w/ a head node.
       MPI::Group dispatchGroup;
 
+      const bool isHeadNode = world.rank < numHeadNodes;
       if (hasHeadNode) {
         MPI_Comm intraComm, interComm;
-        MPI_CALL(Comm_split(world.comm,1+(world.rank>0),world.rank,&intraComm));
+        MPI_CALL(Comm_split(world.comm,1+!isHeadNode,world.rank,&intraComm));
         
-        if (world.rank == 0) {
+        if (isHeadNode) {
           dispatchGroup = MPI::Group(intraComm);
-          MPI_Intercomm_create(intraComm,0,world.comm, 1, 1, &interComm); 
+          MPI_Intercomm_create(intraComm,0,world.comm, numHeadNodes, 1, &interComm); 
           displayGroup = MPI::Group(interComm);
         } else {
           displayGroup = MPI::Group(intraComm);
@@ -230,13 +273,15 @@ namespace ospray {
 
       commThreadIsReady.unlock();
       if (hasHeadNode) {
-        if (world.rank == 0) {
+        if (isHeadNode) {
           // =======================================================
           // DISPATCHER
           // =======================================================
           MPI::Group outsideConnection
             = waitForConnection(dispatchGroup,desiredInfoPortNum);
-          runDispatcher(outsideConnection,displayGroup,wallConfig);
+          runDispatcher(outsideConnection,displayGroup,wallConfig,
+                        wallConfig.displaysOfHeadNode(world.rank,numHeadNodes),
+                        transcodeOnHeadNodes,numForwardingThreads);
         } else {
           // =======================================================
           // TILE RECEIVER
@@ -252,43 +297,68 @@ namespace ospray {
         canStartProcessing.lock();
         MPI::Group incomingTiles
           = waitForConnection(displayGroup,desiredInfoPortNum);
-        processIncomingTiles(incomingTiles);
+        if (putFrames)
+          processPutFrames(incomingTiles);
+        else if (exchangeFrames)
+          processExchangedFrames(incomingTiles);
+        else
+          processIncomingTiles(incomingTiles);
       }
     }
     
     void startDisplayWallService(const MPI_Comm comm,
                                  const WallConfig &wallConfig,
-                                 bool hasHeadNode,
+                                 int numHeadNodes,
                                  DisplayCallback displayCallback,
                                  void *objectForCallback,
-                                 int desiredInfoPortNum)
+                                 int desiredInfoPortNum,
+                                 const ServiceOptions &options)
     {
       assert(Server::singleton == NULL);
-      Server::singleton = new Server(MPI::Group(comm),wallConfig,hasHeadNode,
+      Server::singleton = new Server(MPI::Group(comm),wallConfig,numHeadNodes,
                                      displayCallback,objectForCallback,
-                                     desiredInfoPortNum);
+                                     desiredInfoPortNum,options);
     }
 
     Server::Server(const MPI::Group &world,
                    const WallConfig &wallConfig,
-                   const bool hasHeadNode,
+                   const int numHeadNodes,
                    DisplayCallback displayCallback,
                    void *objectForCallback,
-                   int desiredInfoPortNum)
+                   int desiredInfoPortNum,
+                   const ServiceOptions &options)
       : me(world.dup()),
         wallConfig(wallConfig),
-        hasHeadNode(hasHeadNode),
+        numHeadNodes(std::max(0,numHeadNodes)),
+        hasHeadNode(numHeadNodes > 0),
+        transcodeOnHeadNodes(options.transcodeOnHeadNodes),
+        numForwardingThreads(std::max(1,options.numForwardingThreads)),
+        decodeWholeFrames(options.decodeWholeFrames),
+        numReceiveThreads(std::max(1,options.numReceiveThreads)),
+        numDecodeThreads(options.numDecodeThreads > 0
+                         ? options.numDecodeThreads
+                         : std::max(1,(int)std::thread::hardware_concurrency()
+                                    - numReceiveThreads)),
+        pinThreads(options.pinThreads),
+        putFrames(options.putFrames),
+        sharedMemoryTiles(options.sharedMemoryTiles && !hasHeadNode && !putFrames
+                          && !options.exchangeFrames),
+        exchangeFrames(options.exchangeFrames),
         displayCallback(displayCallback),
         objectForCallback(objectForCallback),
         // commThread(NULL),
-        numWrittenThisFrame(0),
-        numExpectedThisFrame(wallConfig.displayPixelCount()),
-        recv_l(NULL),
-        recv_r(NULL),
-        disp_l(NULL),
-        disp_r(NULL),
+        numExpectedPerFrame(wallConfig.displayPixelCount()),
+        maxFramesInFlight(std::max(1,options.maxFramesInFlight)),
+        frameQueue(NULL),
+        lastCompletedFrame(-1),
         desiredInfoPortNum(desiredInfoPortNum)
     {
+      if (putFrames && hasHeadNode)
+        throw std::runtime_error("clients can only put frames straight into the "
+                                 "displays' buffers without head nodes");
+      if (exchangeFrames && (hasHeadNode || putFrames))
+        throw std::runtime_error("clients can only exchange whole frames with the "
+                                 "displays without head nodes, and without putting frames");
       commThreadIsReady.lock();
       canStartProcessing.lock();
 #if 1
@@ -298,8 +368,8 @@ namespace ospray {
       commThreadIsReady.lock();
 #endif
  
-      if (hasHeadNode && me.rank == 0) {
-        /* if this is the head node we wait here until everything is
+      if (me.rank < numHeadNodes) {
+        /* if this is a head node we wait here until everything is
            done; this prevents the comm thread from dying when we
            return to main - unlike other ranks the head node will NOT
            open a window and enter a windowing loop.... */
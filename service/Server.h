@@ -24,7 +24,11 @@ SOFTWARE.
 
 #include "../common/MPI.h"
 #include "../common/WallConfig.h"
+#include "../common/CompressedTile.h"
+#include "FrameQueue.h"
+#include <atomic>
 #include <thread>
+#include <vector>
 
 namespace ospray {
   namespace dw {
@@ -32,10 +36,63 @@ namespace ospray {
     #define DW_STEREO 1
     #define DW_HAVE_HEAD_NODE 2
     
-    typedef void (*DisplayCallback)(const uint32_t *leftEye, 
-                                    const uint32_t *rightEye,
+    /*! gets called (on one of the service's threads) whenever a new
+        frame has been published to the given queue; the presenter
+        takes it from there (see FrameQueue::takeLatest()). Must not
+        block */
+    typedef void (*DisplayCallback)(FrameQueue *frames,
                                     void *objects);
 
+    /*! tuning knobs of the display wall service; the defaults are
+        what a single display node with a handful of cores wants */
+    struct ServiceOptions {
+      /*! how many frames clients may send ahead of the last frame
+          that all displays have completed */
+      int  maxFramesInFlight    { 2 };
+      /*! whether head nodes crop (and re-encode) tiles that straddle
+          several displays (see Server::transcodeOnHeadNodes) */
+      bool transcodeOnHeadNodes { false };
+      /*! number of threads (per head node) that receive tile batches
+          from the clients and forward them to the displays */
+      int  numForwardingThreads { 3 };
+      /*! whether displays decode each frame in one parallel burst
+          (see Server::decodeWholeFrames) */
+      bool decodeWholeFrames    { false };
+      /*! number of threads (per display) that do nothing but receive
+          tile batches, and hand them to the decode threads; they
+          poll MPI side by side (see ReceiveEngine), so more of them
+          help when a single one can't keep up with taking batches
+          off the wire */
+      int  numReceiveThreads    { 1 };
+      /*! number of threads (per display) that decode the received
+          tiles and write them into the frame buffers; 0 means one per
+          hardware thread not taken by a receive thread */
+      int  numDecodeThreads     { 0 };
+      /*! whether to pin the receive and decode threads to one core
+          each (receive threads on the first cores, decode threads on
+          the ones after those); keeps each thread's decoders and
+          scratch memory on its own core. This is not NUMA-aware: it
+          goes by core number only, and doesn't place receive threads
+          near the network card, nor threads near the frame buffers */
+      bool pinThreads           { false };
+      /*! whether clients write raw pixels straight into the
+          displays' receive buffers (with one-sided MPI, see
+          FrameWindow), rather than sending them tiles; only works
+          without head nodes */
+      bool putFrames            { false };
+      /*! whether clients that run on the same node as a display send
+          that display their tiles through shared memory rather than
+          MPI (see ShmTileRing); only works without head nodes, and
+          doesn't apply with putFrames or exchangeFrames */
+      bool sharedMemoryTiles    { true };
+      /*! whether clients send all of a frame's tiles in one
+          collective exchange with all displays (see FrameExchange),
+          rather than as individual messages; the displays then
+          decode each frame as a whole. Only works without head
+          nodes, and not with putFrames */
+      bool exchangeFrames       { false };
+    };
+
     /*! the server that runs the display wall service (ie, the entity
         that communicates with the client(s), receives tiles, decodes
         them, and passes them to the display callback whenever a frame
@@ -43,14 +100,21 @@ namespace ospray {
     struct Server {
       Server(const MPI::Group &me,
              const WallConfig &wallConfig,
-             const bool hasHeadNode,
+             const int numHeadNodes,
              DisplayCallback displayCallback,
              void *objectForCallback,
-             int desiredInfoPortNum);
+             int desiredInfoPortNum,
+             const ServiceOptions &options);
 
       /*! the code that actually receives the tiles, decompresses
           them, and writes them into the current (write-)frame buffer */
       void processIncomingTiles(MPI::Group &outside);
+      /*! with putFrames: the code that waits for the clients to have
+          put each frame into our receive buffers, and publishes it */
+      void processPutFrames(MPI::Group &outside);
+      /*! with exchangeFrames: the code that receives each frame's
+          tiles from all clients at once, and decodes them */
+      void processExchangedFrames(MPI::Group &outside);
 
       /*! note: this runs in its own thread */
       void setupCommunications();
@@ -66,9 +130,48 @@ namespace ospray {
       MPI::Group waitForConnection(const MPI::Group &outwardFacingGroup,
                                    int desiredInfoPortNum);
 
-      /*! allocate the frame buffers for left/right eye and recv/display, respectively */
+      /*! allocate the frame buffers for all frame slots */
       void allocateFrameBuffers();
 
+      /*! a frame in flight (or the last completed one): its tiles
+          get assembled in the slot's frame buffer; once it is
+          complete, that buffer gets published to the presenter, and
+          serves as the reference for 'unchanged' and 'delta' tiles
+          of the next frame */
+      struct FrameSlot {
+        /*! the frame currently in this slot; -1 if none. Gets set
+            last when claiming the slot (with frameMutex held), so
+            decode threads can check it without the mutex */
+        std::atomic<int> frameID { -1 };
+        /*! the slot's reference to its frame buffer; gets released
+            (and a new buffer acquired) when the slot gets re-used */
+        Frame    *frame   { nullptr };
+        /*! total number of pixels already written for this frame
+            (or, for a dropped frame, discarded); decode threads add
+            to it without holding any lock */
+        std::atomic<size_t> numWritten { 0 };
+        /*! tiles of this frame that came in while an older frame
+            than the previous one was still incomplete; they get kept
+            (still compressed) until the previous frame is complete,
+            and then either get written, or - if this frame gets
+            dropped - discarded without ever decoding them */
+        std::vector<CompressedTile *> pending;
+        /*! number of pixels in 'pending' */
+        size_t    numPending { 0 };
+        /*! whether none of the pending tiles reference the previous
+            frame; if such a frame is fully pending, the previous
+            frame will never be shown, nor referenced */
+        bool      selfContained { true };
+        /*! whether this frame got dropped: it still has to be
+            completed (like any other frame), but its tiles get
+            counted without decoding them, and it doesn't get
+            published */
+        bool      dropped { false };
+      };
+      /*! get the slot for given frame, and claim it for that frame
+          if it isn't yet */
+      FrameSlot &slotOf(int frameID);
+
       static Server *singleton;
 
       static std::thread commThread;
@@ -81,31 +184,75 @@ namespace ospray {
       MPI::Group displayGroup;
 
       const WallConfig wallConfig;
+      /*! number of dedicated head nodes (ranks 0..numHeadNodes-1 of
+          'me'), each dispatching to its own block of displays (see
+          WallConfig::displaysOfHeadNode()); 0 if clients talk to the
+          displays directly */
+      const int numHeadNodes;
       const bool hasHeadNode;
+      /*! whether head nodes crop (and re-encode) tiles that straddle
+          several displays, rather than sending each of those
+          displays the entire tile */
+      const bool transcodeOnHeadNodes;
+      /*! number of forwarding threads per head node (see
+          ServiceOptions) */
+      const int  numForwardingThreads;
+      /*! whether displays only collect a frame's (compressed) tiles
+          as they come in, and then decode all of them at once, in
+          parallel (on all decode threads), once the frame is
+          otherwise complete - rather than decoding every tile as soon
+          as it comes in */
+      const bool decodeWholeFrames;
+      /*! number of receive and decode threads per display, and
+          whether they get pinned (see ServiceOptions) */
+      const int  numReceiveThreads;
+      const int  numDecodeThreads;
+      const bool pinThreads;
+      /*! whether clients put raw pixels straight into the displays'
+          receive buffers (see ServiceOptions::putFrames) */
+      const bool putFrames;
+      /*! whether co-located clients send us tiles through shared
+          memory (see ServiceOptions::sharedMemoryTiles) */
+      const bool sharedMemoryTiles;
+      /*! whether clients send each frame's tiles in one collective
+          exchange (see ServiceOptions::exchangeFrames) */
+      const bool exchangeFrames;
       
       const DisplayCallback displayCallback;
       void *const objectForCallback;
 
-      /*! total number of pixels already written this frame */
-      size_t numWrittenThisFrame;
-      /*! total number of pixels we have to write this frame until we
+      /*! total number of pixels we have to write per frame until we
           have a full frame buffer */
-      size_t numExpectedThisFrame;
+      const size_t numExpectedPerFrame;
 
-      /*! @{ the four pixel arrays for left/right eye and
-          receive/display buffers, respectively */
-      uint32_t *recv_l, *recv_r, *disp_l, *disp_r;
-      /*! @} */
+      /*! how many frames clients may send ahead of the last frame
+          that all displays have completed (see sendConfigToClient()) */
+      const int maxFramesInFlight;
+      /*! maxFramesInFlight+1 slots: the frames in flight, plus the
+          last completed one */
+      std::vector<FrameSlot> frameSlots;
+      /*! frame buffers for the slots, plus one for the published
+          frame, and one for the frame the presenter is showing */
+      FrameQueue *frameQueue;
+      /*! the last frame that was complete on this display; only
+          advanced with frameMutex held (see processIncomingTiles()),
+          but read without it */
+      std::atomic<int> lastCompletedFrame;
 
       int desiredInfoPortNum;
     };
 
+    /*! 'numHeadNodes' is the number of dedicated head nodes (0 for
+        none); the first that many ranks of 'comm' become head nodes,
+        the remaining ones are the displays. See ServiceOptions for
+        the rest */
     void startDisplayWallService(const MPI_Comm comm,
                                  const WallConfig &wallConfig,
-                                 bool hasHeadNode,
+                                 int numHeadNodes,
                                  DisplayCallback displayCallback,
                                  void *objectForCallback,
-                                 int desiredInfoPortNum);
+                                 int desiredInfoPortNum,
+                                 const ServiceOptions &options = ServiceOptions());
 
   } // ::ospray::dw
 } // ::ospray
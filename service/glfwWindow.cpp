@@ -36,11 +36,9 @@ namespace ospray {
       : size(size),
         position(position),
         title(title),
-        leftEye(NULL),
-        rightEye(NULL),
+        frames(NULL),
+        current(NULL),
         stereo(stereo),
-        receivedFrameID(-1),
-        displayedFrameID(-1),
         doFullScreen(doFullScreen)
     {
       create();
@@ -74,39 +72,39 @@ namespace ospray {
       glfwMakeContextCurrent(this->handle);
     }
 
-    void GLFWindow::setFrameBuffer(const uint32_t *leftEye, const uint32 *rightEye)
+    void GLFWindow::newFrameAvailable(FrameQueue *frames)
     {
-      {
-        std::lock_guard<std::mutex> lock(this->mutex);
-        this->leftEye = leftEye;
-        this->rightEye = rightEye;
-        receivedFrameID++;
-        newFrameAvail.notify_one();
-      }
+      this->frames = frames;
+      // wake up the render loop, if it's waiting for events
+      glfwPostEmptyEvent();
     }
 
     void GLFWindow::display() 
     {
-      {
-        std::unique_lock<std::mutex> lock(mutex);
-        newFrameAvail.wait(lock,[this](){return receivedFrameID > displayedFrameID; });
-        // glfwShowWindow(window);
-
-
-        if (!leftEye) {
-          /* invalid ... */
-        } else {
-          assert(rightEye == NULL);
-          // no stereo
-          // glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-          glDrawPixels(size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, leftEye);
+      FrameQueue *frames = this->frames;
+      if (frames) {
+        Frame *latest = frames->takeLatest();
+        if (latest) {
+          if (current)
+            frames->release(current);
+          current = latest;
+
+          /* report frames that never got shown, at most once a second */
+          const double now = getSysTime();
+          if (current->numDroppedBefore > numDroppedReported && now > lastDropReport+1.) {
+            printf("#osp:dw: %zu frames dropped so far\n",current->numDroppedBefore);
+            numDroppedReported = current->numDroppedBefore;
+            lastDropReport     = now;
+          }
         }
-      
       }
-      {
-        std::lock_guard<std::mutex> lock(mutex);
-        displayedFrameID++;
-        newFrameDisplayed.notify_one();
+
+      if (!current) {
+        /* nothing received yet ... */
+      } else {
+        // no stereo
+        // glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glDrawPixels(size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, current->pixel_l);
       }
     }
 
@@ -124,7 +122,9 @@ namespace ospray {
     { 
       while (!glfwWindowShouldClose(this->handle)) {
         
-        glfwPollEvents();
+        /* sleeps until either some window event, or a new frame
+           (see newFrameAvailable()) */
+        glfwWaitEvents();
 
         vec2i currentSize(0);
         glfwGetFramebufferSize(this->handle, &currentSize.x, &currentSize.y);
@@ -134,8 +134,6 @@ namespace ospray {
 
         display();
         glfwSwapBuffers(this->handle);
-
-        usleep(1000);
       }
     }
     
@@ -23,11 +23,11 @@ SOFTWARE.
 #pragma once
 
 #include "FrameBuffer.h"
+#include "FrameQueue.h"
 // windowing stuff
 #include "GLFW/glfw3.h"
 // std
-#include <mutex>
-#include <condition_variable>
+#include <atomic>
 
 namespace ospray {
   namespace dw {
@@ -48,8 +48,11 @@ namespace ospray {
         std::cout << "%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%" << std::endl;
       }
 
-      void setFrameBuffer(const uint32_t *leftEye,
-                          const uint32_t *rightEye);
+      /*! a new frame has been published to 'frames'; may get called
+          from any thread, and doesn't block */
+      void newFrameAvailable(FrameQueue *frames);
+      /*! draw the latest published frame (or, if there's no new one,
+          the one we showed last time) */
       void display(); 
       vec2i getSize()   const;
       bool doesStereo() const;
@@ -63,19 +66,19 @@ namespace ospray {
       }
 
     // private:
-      const uint32_t *leftEye;
-      const uint32_t *rightEye;
+      /*! where new frames come from; NULL until the first one */
+      std::atomic<FrameQueue *> frames;
+      /*! the frame we're currently showing; we hold a reference to
+          it until we show the next one */
+      Frame *current;
+      /*! number of dropped frames we last reported, and when */
+      size_t numDroppedReported { 0 };
+      double lastDropReport     { 0. };
 
       GLFWwindow *handle { nullptr };
 
-      std::mutex mutex;
-      std::condition_variable newFrameAvail;
-      std::condition_variable newFrameDisplayed;
-
       vec2i size, position;
       bool stereo;
-      int receivedFrameID;
-      int displayedFrameID;
       bool doFullScreen;
       std::string title;
       // static GLFWindow *singleton;
@@ -45,16 +45,25 @@ namespace ospray {
       cout << "--height|-h <numDisplays.y>       - num displays in y direction" << endl;
       cout << "--window-size|-ws <res_x> <res_y> - window size (in pixels)" << endl;
       cout << "--[no-]head-node | -[n]hn         - use / do not use dedicated head node" << endl;
+      cout << "--head-nodes|-hns <n>             - use <n> dedicated head nodes (on ranks 0..n-1)" << endl;
+      cout << "--transcode|-tc                   - head nodes crop tiles that straddle displays" << endl;
+      cout << "--decode-whole-frames|-dwf        - decode each frame at once, once all of it is there" << endl;
+      cout << "--frames-in-flight|-fif <n>       - max frames clients may send ahead (default 2)" << endl;
+      cout << "--receive-threads|-rt <n>         - threads per display receiving tiles (default 1)" << endl;
+      cout << "--decode-threads|-dt <n>          - threads per display decoding tiles (default: all other cores)" << endl;
+      cout << "--pin-threads|-pin                - pin receive and decode threads to a core each" << endl;
+      cout << "--put-frames|-put                 - clients put raw pixels straight into display buffers (no head nodes)" << endl;
+      cout << "--no-shm|-noshm                   - send tiles through MPI even from clients on the display's node" << endl;
+      cout << "--exchange-frames|-xf             - clients send each frame's tiles in one all-to-all (no head nodes)" << endl;
       exit(!err.empty());
     }
 
     /*! the display callback */
-    void displayNewFrame(const uint32_t *left, 
-                         const uint32_t *right, 
+    void displayNewFrame(FrameQueue *frames,
                          void *object)
     {
       GLFWindow *window = (GLFWindow*)object;
-      window->setFrameBuffer(left,right);
+      window->newFrameAvailable(frames);
     }
 
     extern "C" int main(int ac, char **av)
@@ -79,7 +88,7 @@ namespace ospray {
 
 
       // default settings
-      bool hasHeadNode  = false;
+      int  numHeadNodes = 0;
       bool doStereo     = false;
       bool doFullScreen = false;
       WallConfig::DisplayArrangement arrangement = WallConfig::Arrangement_xy;
@@ -88,15 +97,40 @@ namespace ospray {
       vec2i windowPosition(0,0);
       vec2i numDisplays(0,0);
       int desiredInfoPortNum=2903;
+      ServiceOptions options;
 
       for (int i=1;i<ac;i++) {
         const std::string arg = av[i];
         if (arg == "--head-node" || arg == "-hn") {
-          hasHeadNode = true;
+          numHeadNodes = 1;
+        } else if (arg == "--head-nodes" || arg == "-hns") {
+          assert(i+1<ac);
+          numHeadNodes = atoi(av[++i]);
+        } else if (arg == "--transcode" || arg == "-tc") {
+          options.transcodeOnHeadNodes = true;
+        } else if (arg == "--forwarding-threads" || arg == "-ft") {
+          assert(i+1<ac);
+          options.numForwardingThreads = atoi(av[++i]);
+        } else if (arg == "--decode-whole-frames" || arg == "-dwf") {
+          options.decodeWholeFrames = true;
+        } else if (arg == "--receive-threads" || arg == "-rt") {
+          assert(i+1<ac);
+          options.numReceiveThreads = atoi(av[++i]);
+        } else if (arg == "--decode-threads" || arg == "-dt") {
+          assert(i+1<ac);
+          options.numDecodeThreads = atoi(av[++i]);
+        } else if (arg == "--pin-threads" || arg == "-pin") {
+          options.pinThreads = true;
+        } else if (arg == "--put-frames" || arg == "-put") {
+          options.putFrames = true;
+        } else if (arg == "--no-shm" || arg == "-noshm") {
+          options.sharedMemoryTiles = false;
+        } else if (arg == "--exchange-frames" || arg == "-xf") {
+          options.exchangeFrames = true;
         } else if (arg == "--stereo" || arg == "-s") {
           doStereo = true;
         } else if (arg == "--no-head-node" || arg == "-nhn") {
-          hasHeadNode = false;
+          numHeadNodes = 0;
         } else if (arg == "--width" || arg == "-w") {
           assert(i+1<ac);
           numDisplays.x = atoi(av[++i]);
@@ -135,6 +169,8 @@ namespace ospray {
           relativeBezelWidth.y = atof(av[++i]);
         } else if (arg == "--port" || arg == "-p") {
           desiredInfoPortNum = atoi(av[++i]);
+        } else if (arg == "--frames-in-flight" || arg == "-fif") {
+          options.maxFramesInFlight = atoi(av[++i]);
         } else {
           usage("unkonwn arg "+arg);
         } 
@@ -145,10 +181,12 @@ namespace ospray {
         usage("no display wall width specified (--width <w>)");
       if (numDisplays.y < 1) 
         usage("no display wall height specified (--heigh <h>)");
-      if (world.size != numDisplays.x*numDisplays.y+hasHeadNode)
+      if (numHeadNodes < 0)
+        usage("invalid number of head nodes");
+      if (world.size != numDisplays.x*numDisplays.y+numHeadNodes)
         throw std::runtime_error("invalid number of ranks for given display/head node config");
 
-      const int displayNo = hasHeadNode ? world.rank-1 : world.rank;
+      const int displayNo = world.rank-numHeadNodes;
       const vec2i displayID(displayNo % numDisplays.x, displayNo / numDisplays.x);
 
       char title[1000];
@@ -186,17 +224,18 @@ namespace ospray {
       // }
 
       GLFWindow *glfWindow = nullptr;
-      if (hasHeadNode && world.rank == 0) {
-        cout << "#osp:dw: running a dedicated headnode on rank 0; "
+      if (world.rank < numHeadNodes) {
+        cout << "#osp:dw: running a dedicated headnode on rank " << world.rank << "; "
              << "not creating a window there" << endl;
       } else {
         glfWindow = new GLFWindow(windowSize,windowPosition,title,doFullScreen,doStereo);
       }
 
-      startDisplayWallService(world.comm,wallConfig,hasHeadNode,
-                              displayNewFrame,glfWindow,desiredInfoPortNum);
+      startDisplayWallService(world.comm,wallConfig,numHeadNodes,
+                              displayNewFrame,glfWindow,desiredInfoPortNum,
+                              options);
       
-      if (hasHeadNode && world.rank == 0) {
+      if (world.rank < numHeadNodes) {
         /* no window on head node - should never have returend from setupComms*/
         assert(false);
       } else {
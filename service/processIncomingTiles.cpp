@@ -1,11 +1,23 @@
 
 #include "Server.h"
-#include "../common/CompressedTile.h"
+#include "../common/ReceiveEngine.h"
+#include "../common/ConcurrentQueue.h"
+#include "../common/ShmTileRing.h"
+#include "../common/FrameExchange.h"
 #include "ospcommon/tasking/parallel_for.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <mutex>
 #ifdef OSPRAY_TASKING_TBB
 # include <tbb/task_scheduler_init.h>
 #endif
+#ifdef __linux__
+# include <pthread.h>
+# include <sched.h>
+#endif
 
 namespace ospray {
   namespace dw {
@@ -16,8 +28,114 @@ namespace ospray {
     using std::endl;
     using std::flush;
 
+    /*! write the part of the given tile that is visible on this
+        display into the given frame buffer; 'prevPixel' is the
+        previous frame's buffer (only used by 'unchanged' and 'delta'
+        tiles). Returns the number of pixels written */
+    static size_t assembleTile(CompressedTile &encoded,
+                               CodecSet &codecs,
+                               std::vector<uint32_t> &scratch,
+                               const box2i &displayRegion,
+                               const int localPitch,
+                               uint32_t *localPixel,
+                               const uint32_t *prevPixel)
+    {
+      const box2i region  = encoded.getRegion();
+      const box2i visible = intersectionOf(region,displayRegion);
+      const vec2i visibleSize = visible.size();
+      if (visibleSize.x <= 0 || visibleSize.y <= 0)
+        return 0;
+
+      const CodecType codec = encoded.getCodec();
+      assert(localPixel);
+      assert(prevPixel || (codec != CODEC_UNCHANGED && codec != CODEC_DELTA));
+      const int localOfs
+        = (visible.lower.x-displayRegion.lower.x)
+        + localPitch * (visible.lower.y-displayRegion.lower.y);
+
+      if (codec == CODEC_UNCHANGED) {
+        // -------------------------------------------------------
+        // same content as in previous frame: copy over from the
+        // previous frame's buffer
+        // -------------------------------------------------------
+        copyPixels(localPixel+localOfs,localPitch,
+                   prevPixel+localOfs,localPitch,
+                   visibleSize);
+      } else if (visibleSize == region.size()) {
+        // -------------------------------------------------------
+        // tile entirely on this display: decode straight into
+        // the frame buffer; for delta tiles, that gives us the
+        // residual, to which we then add the previous frame
+        // -------------------------------------------------------
+        PlainTile target(localPixel+localOfs,localPitch);
+        encoded.decode(codecs,target);
+        if (codec == CODEC_DELTA)
+          addPixels(localPixel+localOfs,localPitch,
+                    prevPixel+localOfs,localPitch,
+                    localPixel+localOfs,localPitch,
+                    visibleSize);
+      } else {
+        // -------------------------------------------------------
+        // tile straddles a display edge: decode into scratch
+        // memory, and copy (or add) only the visible part
+        // -------------------------------------------------------
+        const vec2i tileSize = region.size();
+        scratch.resize(tileSize.product());
+        PlainTile plain(scratch.data(),tileSize.x);
+        encoded.decode(codecs,plain);
+        const int tileOfs
+          = (visible.lower.x-region.lower.x)
+          + plain.pitch * (visible.lower.y-region.lower.y);
+        if (codec == CODEC_DELTA)
+          addPixels(localPixel+localOfs,localPitch,
+                    prevPixel+localOfs,localPitch,
+                    plain.pixel+tileOfs,plain.pitch,
+                    visibleSize);
+        else
+          copyPixels(localPixel+localOfs,localPitch,
+                     plain.pixel+tileOfs,plain.pitch,
+                     visibleSize);
+      }
+      return visibleSize.product();
+    }
+
+    /*! pin the calling thread to the given core (modulo the number
+        of cores); does nothing where we don't know how to */
+    static void pinToCore(int core)
+    {
+#ifdef __linux__
+      const int numCores = std::max(1,(int)std::thread::hardware_concurrency());
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(core % numCores,&cpus);
+      if (pthread_setaffinity_np(pthread_self(),sizeof(cpus),&cpus) != 0)
+        printf("#osp:dw: could not pin thread to core %i\n",core % numCores);
+#endif
+    }
+
+    /*! wait a little while a stage has nothing to do (or can't hand
+        on what it has): spin briefly, then yield, then sleep */
+    static void backOff(int numTries)
+    {
+      if (numTries < 16)
+        return;
+      if (numTries < 64)
+        std::this_thread::yield();
+      else
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
+    /*! max number of received batches waiting for a decode thread;
+        receive threads stall (and leave the messages to MPI) beyond
+        that */
+#define RECEIVED_BATCH_QUEUE_SIZE 256
+
     /*! the code that actually receives the tiles, decompresses
-      them, and writes them into the current (write-)frame buffer */
+      them, and writes them into the frame buffer of the frame they
+      belong to. This runs as two stages: 'numReceiveThreads' threads
+      that only receive tile batches, and hand them on (through a
+      lock-free queue) to 'numDecodeThreads' threads that decode them
+      and write them into the frame buffers */
     void Server::processIncomingTiles(MPI::Group &outside)
     {
       allocateFrameBuffers();
@@ -25,86 +143,566 @@ namespace ospray {
 //              displayGroup.rank,displayGroup.size);
       
       const box2i displayRegion = wallConfig.regionOfRank(displayGroup.rank);
+      const int   localPitch    = wallConfig.pixelsPerDisplay.x;
+      const int   numSlots      = frameSlots.size();
+      auto slotAt = [&](int frameID) -> FrameSlot & {
+        return frameSlots[((frameID % numSlots) + numSlots) % numSlots];
+      };
 
-#define THREADED_RECV 3
-        
-#if THREADED_RECV
-      std::mutex displayMutex;
-# ifdef OSPRAY_TASKING_TBB
-      tbb::task_scheduler_init tbb_init;
-# endif
-      tasking::parallel_for(THREADED_RECV,[&](int) {
-#endif
-          void *decompressor = CompressedTile::createDecompressor();
+      /* pre-posted receives, shared by all receiving threads */
+      ReceiveEngine receiver(outside);
+      /* tile rings from the clients on our own node (by client
+         rank), if any */
+      std::vector<ShmTileRing *> localRings;
+      if (sharedMemoryTiles)
+        localRings = ShmTileRing::connect(outside,true);
+      const int numLocalClients
+        = localRings.size() - std::count(localRings.begin(),localRings.end(),nullptr);
+
+      /* protects the frame slots' bookkeeping (other than counting
+         written pixels), the ready tiles, and the queue of completed
+         frames */
+      std::mutex frameMutex;
+      std::condition_variable frameCompleted;
+      std::deque<int> completedFrames;
+
+      /* completed frames get handed to this thread, which waits for
+         all other displays (which also releases the clients into the
+         next frame), and then publishes them to the presenter; so the
+         receiving threads never block on the barrier, and can go on
+         with the tiles of the frames that are still in flight */
+      std::thread completionThread([&]() {
           while (1) {
-            // -------------------------------------------------------
-            // receive one tiles
-            // -------------------------------------------------------
-
-            CompressedTile encoded;
-            encoded.receiveOne(outside);
-
-            PlainTile plain(encoded.getRegion().size());
-            encoded.decode(decompressor,plain);
-
-            const box2i globalRegion = plain.region;
-            size_t numWritten = 0;
-            const uint32_t *tilePixel = plain.pixel;
-            uint32_t *localPixel = plain.eye ? recv_r : recv_l;
-            assert(localPixel);
-            for (int iy=globalRegion.lower.y;iy<globalRegion.upper.y;iy++) {
-              
-              if (iy < displayRegion.lower.y) continue;
-              if (iy >= displayRegion.upper.y) continue;
-              
-              for (int ix=globalRegion.lower.x;ix<globalRegion.upper.x;ix++) {
-                if (ix < displayRegion.lower.x) continue;
-                if (ix >= displayRegion.upper.x) continue;
-                
-                const vec2i globalCoord(ix,iy);
-                const vec2i tileCoord = globalCoord-plain.region.lower;
-                const vec2i localCoord = globalCoord-displayRegion.lower;
-                const int localPitch = wallConfig.pixelsPerDisplay.x;
-                const int tilePitch  = plain.pitch;
-                const int tileOfs = tileCoord.x + tilePitch * tileCoord.y;
-                const int localOfs = localCoord.x + localPitch * localCoord.y;
-                localPixel[localOfs] = tilePixel[tileOfs];
-                ++numWritten;
+            int  frameID;
+            bool dropped;
+            {
+              std::unique_lock<std::mutex> lock(frameMutex);
+              frameCompleted.wait(lock,[&]() { return !completedFrames.empty(); });
+              frameID = completedFrames.front();
+              completedFrames.pop_front();
+              dropped = slotAt(frameID).dropped;
+            }
+            DW_DBG(printf("#osp:dw(%i/%i) barrier'ing on %i/%i\n",
+                          displayGroup.rank,displayGroup.size,
+                          outside.rank,outside.size));
+            /* clients don't block on their end of this barrier (see
+               Client::endFrame()), so this has to be the
+               non-blocking kind, too. Some MPIs let all but the root
+               out of such a barrier early (see
+               Client::progressFrame()), so before we show the frame
+               we also wait for all other displays to have it */
+            MPI_Request frameDone = outside.ibarrier();
+            MPI_CALL(Wait(&frameDone,MPI_STATUS_IGNORE));
+            displayGroup.barrier();
+            DW_DBG(printf("#osp:dw(%i/%i): DISPLAYING\n",
+                          displayGroup.rank,displayGroup.size));
+            if (dropped) {
+              frameQueue->countDropped();
+              continue;
+            }
+            frameQueue->publish(slotAt(frameID).frame);
+            displayCallback(frameQueue,objectForCallback);
+          }
+        });
+
+      /* tiles whose previous frame just got completed (see
+         FrameSlot::pending) - or, with decodeWholeFrames, all tiles
+         of a frame that is otherwise complete; all decode threads
+         help writing them */
+      std::deque<CompressedTile *> readyTiles;
+      /* readyTiles.size(), so decode threads can check for those
+         without taking frameMutex */
+      std::atomic<size_t> numReadyTiles(0);
+
+      /* number of pixels of the given tile that are on this display */
+      auto visiblePixels = [&](const CompressedTile &encoded) -> size_t {
+        const vec2i visibleSize
+          = intersectionOf(encoded.getRegion(),displayRegion).size();
+        return (visibleSize.x > 0 && visibleSize.y > 0) ? visibleSize.product() : 0;
+      };
+
+      /* called (with frameMutex held) once the frame before the
+         given one got completed: the given frame can now be written -
+         unless the frame after it is already fully here, and doesn't
+         reference it, in which case it would never be shown: then we
+         drop it, without decoding any of its tiles */
+      auto startFrame = [&](int frameID) {
+        FrameSlot &next  = slotAt(frameID);
+        FrameSlot &later = slotAt(frameID+1);
+        if (next.frameID != frameID)
+          return;
+        if (later.frameID == frameID+1
+            && later.numPending == numExpectedPerFrame
+            && later.selfContained) {
+          DW_DBG(printf("display %i/%i dropping frame %i\n",
+                        displayGroup.rank,displayGroup.size,frameID));
+          next.dropped = true;
+          next.numWritten += next.numPending;
+          for (auto tile : next.pending)
+            delete tile;
+        } else if (decodeWholeFrames)
+          /* gets written all at once, as soon as all of it is here
+             (see takeWholeFrame()) */
+          return;
+        else
+          readyTiles.insert(readyTiles.end(),next.pending.begin(),next.pending.end());
+        next.pending.clear();
+        next.numPending = 0;
+        numReadyTiles = readyTiles.size();
+      };
+
+      /* with decodeWholeFrames (and frameMutex held): if the next
+         frame is complete, except for writing its tiles, hand all of
+         those to the decode threads at once */
+      auto takeWholeFrame = [&]() {
+        const int frameID = lastCompletedFrame+1;
+        FrameSlot &next = slotAt(frameID);
+        if (!decodeWholeFrames
+            || next.frameID != frameID
+            || next.dropped
+            || next.pending.empty()
+            || next.numPending < numExpectedPerFrame)
+          return;
+        readyTiles.insert(readyTiles.end(),next.pending.begin(),next.pending.end());
+        next.pending.clear();
+        next.numPending = 0;
+        numReadyTiles = readyTiles.size();
+      };
+
+      /* called (with frameMutex held) whenever some frame's count of
+         written pixels might have become complete: complete whatever
+         frames (in order) are now complete */
+      auto completeFrames = [&]() {
+        while (1) {
+          const int frameID = lastCompletedFrame+1;
+          FrameSlot &slot = slotAt(frameID);
+          if (slot.frameID != frameID
+              || slot.numWritten < numExpectedPerFrame)
+            break;
+          DW_DBG(printf("display %i/%i has a full frame!\n",
+                        displayGroup.rank,displayGroup.size));
+          completedFrames.push_back(frameID);
+          frameCompleted.notify_one();
+          /* the next frame's fate has to be decided before decode
+             threads can see this one as completed: from then on,
+             they write (or discard) its tiles without locking */
+          startFrame(frameID+1);
+          lastCompletedFrame.store(frameID,std::memory_order_release);
+        }
+        takeWholeFrame();
+      };
+
+      /* received batches, on their way to the decode threads; and
+         batches that were decoded, for re-use by the receive threads */
+      ConcurrentQueue<TileBatch *> receivedBatches(RECEIVED_BATCH_QUEUE_SIZE);
+      ConcurrentQueue<TileBatch *> freeBatches(RECEIVED_BATCH_QUEUE_SIZE);
+
+      auto newBatch = [&]() {
+        TileBatch *batch = NULL;
+        if (!freeBatches.pop(batch))
+          batch = new TileBatch;
+        return batch;
+      };
+      auto handOn = [&](TileBatch *batch) {
+        for (int numTries=0;!receivedBatches.push(batch);numTries++)
+          backOff(numTries);
+      };
+
+      /* a batch whose strided tiles' pixels are still on their way */
+      struct StridedBatch {
+        TileBatch               *batch;
+        std::vector<MPI_Request> requests;
+      };
+
+      /* strided tiles' pixels come as messages of their own: for a
+         batch with any of those, we build a copy in which each of
+         them is a raw tile, with the receive of its pixels posted
+         straight into that tile, and only hand that copy on once all
+         of those have arrived - so neither we nor the decode threads
+         ever wait for a sender */
+      auto receiveLoop = [&](int threadID) {
+        if (pinThreads)
+          pinToCore(threadID);
+        auto paddedBytes = [](int numBytes) { return 8 + ((numBytes+7) & ~size_t(7)); };
+        std::deque<StridedBatch> waiting;
+        TileBatch *batch = NULL;
+        while (1) {
+          if (!batch)
+            batch = newBatch();
+          bool received = true;
+          if (waiting.empty())
+            receiver.receive(*batch);
+          else
+            received = receiver.tryReceive(*batch);
+
+          if (received) {
+            size_t numBytes = 0;
+            bool anyStrided = false;
+            batch->forEachTile([&](CompressedTile &tile) {
+                if (tile.getCodec() == CODEC_STRIDED) {
+                  anyStrided = true;
+                  numBytes += paddedBytes(tile.rawBytesOfStrided());
+                } else
+                  numBytes += paddedBytes(tile.numBytes);
+              });
+            if (!anyStrided) {
+              handOn(batch);
+              batch = NULL;
+            } else {
+              /* (the received batch stays ours, for the next receive) */
+              StridedBatch strided;
+              strided.batch = newBatch();
+              strided.batch->clear();
+              strided.batch->reserve(numBytes);
+              strided.batch->fromRank = batch->fromRank;
+              batch->forEachTile([&](CompressedTile &tile) {
+                  if (tile.getCodec() == CODEC_STRIDED) {
+                    unsigned char *raw = strided.batch->append(tile.rawBytesOfStrided());
+                    strided.requests.push_back(tile.receiveStrided(outside,raw));
+                  } else
+                    strided.batch->append(tile);
+                });
+              waiting.push_back(strided);
+            }
+          }
+
+          bool anyArrived = false;
+          for (auto it=waiting.begin();it!=waiting.end();) {
+            int done = 0;
+            MPI_CALL(Testall(it->requests.size(),it->requests.data(),
+                             &done,MPI_STATUSES_IGNORE));
+            if (!done) {
+              ++it;
+              continue;
+            }
+            handOn(it->batch);
+            it = waiting.erase(it);
+            anyArrived = true;
+          }
+          if (!received && !anyArrived)
+            std::this_thread::yield();
+        }
+      };
+
+      /* takes whatever tiles the local clients pushed into their
+         rings, and hands them on to the decode threads, just like
+         the receive threads do with what comes in through MPI */
+      auto localRingLoop = [&]() {
+        TileBatch *batch = NULL;
+        for (int numTries=0;;) {
+          bool gotAny = false;
+          for (int rank=0;rank<(int)localRings.size();rank++) {
+            if (!localRings[rank])
+              continue;
+            if (!batch && !freeBatches.pop(batch))
+              batch = new TileBatch;
+            batch->clear();
+            if (!localRings[rank]->popAll(*batch))
+              continue;
+            batch->fromRank = rank;
+            gotAny = true;
+            for (int numTries=0;!receivedBatches.push(batch);numTries++)
+              backOff(numTries);
+            batch = NULL;
+          }
+          if (gotAny)
+            numTries = 0;
+          else
+            backOff(numTries++);
+        }
+      };
+
+      auto decodeLoop = [&](int threadID) {
+        if (pinThreads)
+          pinToCore(numReceiveThreads+threadID);
+        /* tiles within a frame may use different codecs; each
+           thread has its own set of (stateful) decoders */
+        CodecSet codecs;
+        /* decode target for tiles that are only partly visible on
+           this display */
+        std::vector<uint32_t> scratch;
+        /* pixels this thread wrote (per frame) since it last
+           updated the frame slots' counters */
+        std::vector<std::pair<int,size_t>> written;
+
+        auto countWritten = [&](int frameID, size_t numWritten) {
+          if (!written.empty() && written.back().first == frameID)
+            written.back().second += numWritten;
+          else
+            written.push_back(std::make_pair(frameID,numWritten));
+        };
+        /* add what we wrote to the frame slots' counters; returns
+           whether any frame's count became complete */
+        auto flushWritten = [&]() {
+          bool anyComplete = false;
+          for (auto &w : written)
+            if (slotAt(w.first).numWritten.fetch_add(w.second) + w.second
+                == numExpectedPerFrame)
+              anyComplete = true;
+          written.clear();
+          return anyComplete;
+        };
+        auto assemble = [&](CompressedTile &encoded) {
+          const int frameID = encoded.getFrameID();
+          const int eye = encoded.getEye();
+          const Frame *frame = slotAt(frameID).frame;
+          const Frame *prev  = slotAt(frameID-1).frame;
+          countWritten(frameID,
+                       assembleTile(encoded,codecs,scratch,displayRegion,localPitch,
+                                    eye ? frame->pixel_r : frame->pixel_l,
+                                    prev ? (eye ? prev->pixel_r : prev->pixel_l) : NULL));
+        };
+        /* count a tile of a dropped frame, without writing it */
+        auto discard = [&](CompressedTile &encoded) {
+          countWritten(encoded.getFrameID(),visiblePixels(encoded));
+        };
+        auto processTile = [&](CompressedTile &encoded) {
+          const int frameID = encoded.getFrameID();
+          const CodecType codec = encoded.getCodec();
+          if (!decodeWholeFrames) {
+            /* common case: the tile's slot is claimed, and the
+               previous frame is complete, so whether this frame
+               got dropped is settled - no need for any locking */
+            const FrameSlot &slot = slotAt(frameID);
+            if (slot.frameID.load(std::memory_order_acquire) == frameID
+                && frameID-1 <= lastCompletedFrame.load(std::memory_order_acquire)) {
+              if (slot.dropped)
+                discard(encoded);
+              else
+                assemble(encoded);
+              return;
+            }
+          }
+          bool dropped;
+          {
+            std::lock_guard<std::mutex> lock(frameMutex);
+            FrameSlot &slot = slotOf(frameID);
+            dropped = slot.dropped;
+            if (!dropped
+                && (decodeWholeFrames || frameID-1 > lastCompletedFrame)) {
+              /* the previous frame isn't complete yet, so we
+                 can't resolve this tile yet if it references
+                 that frame; and the frame might still get
+                 superseded before we get to it. Either way:
+                 keep a copy, and decide once the previous frame
+                 is complete (or, with decodeWholeFrames, write
+                 it with all other tiles of its frame) */
+              CompressedTile *copy = new CompressedTile;
+              copy->reserve(encoded.numBytes);
+              memcpy(copy->data,encoded.data,encoded.numBytes);
+              copy->numBytes = encoded.numBytes;
+              copy->fromRank = encoded.fromRank;
+              slot.pending.push_back(copy);
+              slot.numPending += visiblePixels(encoded);
+              if (codec == CODEC_UNCHANGED || codec == CODEC_DELTA)
+                slot.selfContained = false;
+              takeWholeFrame();
+              return;
+            }
+          }
+          if (dropped)
+            discard(encoded);
+          else
+            assemble(encoded);
+        };
+
+        for (int numTries=0;;) {
+          // -------------------------------------------------------
+          // decode the next received batch, if any ...
+          // -------------------------------------------------------
+          TileBatch *batch = NULL;
+          if (receivedBatches.pop(batch)) {
+            numTries = 0;
+            batch->forEachTile(processTile);
+            if (!freeBatches.push(batch))
+              delete batch;
+          } else if (numReadyTiles.load(std::memory_order_relaxed) == 0) {
+            backOff(numTries++);
+            continue;
+          }
+
+          // -------------------------------------------------------
+          // ... update the frames' counters, complete whatever
+          // frames are now complete, and help writing the tiles
+          // that became ready
+          // -------------------------------------------------------
+          bool mayComplete = flushWritten();
+          while (mayComplete || numReadyTiles.load(std::memory_order_relaxed) > 0) {
+            CompressedTile *tile = NULL;
+            {
+              std::lock_guard<std::mutex> lock(frameMutex);
+              if (mayComplete)
+                completeFrames();
+              if (!readyTiles.empty()) {
+                tile = readyTiles.front();
+                readyTiles.pop_front();
+                numReadyTiles = readyTiles.size();
               }
             }
+            if (!tile)
+              break;
+            numTries = 0;
+            // writing this may complete more frames, so loop
+            assemble(*tile);
+            delete tile;
+            mayComplete = flushWritten();
+          }
+        }
+      };
 
+      cout << "#osp:dw: display " << displayGroup.rank << " running "
+           << numReceiveThreads << " receive and " << numDecodeThreads
+           << " decode thread(s)" << (pinThreads ? " (pinned)" : "")
+           << "; " << numLocalClients << " client(s) on this node send tiles"
+           << " through shared memory" << endl;
+      std::vector<std::thread> threads;
+      for (int i=0;i<numReceiveThreads;i++)
+        threads.push_back(std::thread(receiveLoop,i));
+      for (int i=0;i<numDecodeThreads;i++)
+        threads.push_back(std::thread(decodeLoop,i));
+      if (numLocalClients > 0)
+        threads.push_back(std::thread(localRingLoop));
+      for (auto &thread : threads)
+        thread.join();
+      completionThread.join();
+    }
+
+    /*! with exchangeFrames, each frame's tiles come in all at once
+      (see FrameExchange): one thread receives them, and hands them
+      on to this one, which writes all of a frame's tiles in one
+      parallel burst, and publishes the frame; so receiving the next
+      frame overlaps with writing this one. There's no need to count
+      pixels - a frame is complete once it's received */
+    void Server::processExchangedFrames(MPI::Group &outside)
+    {
+      allocateFrameBuffers();
+      FrameExchange exchange(outside);
+
+      const box2i displayRegion = wallConfig.regionOfRank(displayGroup.rank);
+      const int   localPitch    = wallConfig.pixelsPerDisplay.x;
+
+      /*! one frame's tiles, from all clients */
+      struct ReceivedFrame {
+        TileBatch tiles;
+        /*! whether none of its tiles reference the previous frame */
+        bool      selfContained;
+      };
+      /* protects the received frames, and the ones that can be
+         re-used */
+      std::mutex frameMutex;
+      std::condition_variable frameReceived;
+      std::deque<ReceivedFrame *>  receivedFrames;
+      std::vector<ReceivedFrame *> unusedFrames;
+
+      /* clients can't post a frame's tiles before the frame that is
+         maxFramesInFlight frames older is done (which it only is
+         once we've written it), so this can't run away from us */
+      std::thread receiveThread([&]() {
+          if (pinThreads)
+            pinToCore(0);
+          while (1) {
+            ReceivedFrame *received = NULL;
             {
-#if THREADED_RECV
-              std::lock_guard<std::mutex> lock(displayMutex);
-#endif
-              numWrittenThisFrame += numWritten;
-              // printf("written %li / %li\n",numWrittenThisFrame,numExpectedThisFrame);
-              if (numWrittenThisFrame == numExpectedThisFrame) {
-                DW_DBG(printf("display %i/%i has a full frame!\n",
-                              displayGroup.rank,displayGroup.size));
-          
-                // displayGroup.barrier();
-                DW_DBG(printf("#osp:dw(%i/%i) barrier'ing on %i/%i\n",
-                              displayGroup.rank,displayGroup.size,
-                              outside.rank,outside.size));
-                MPI_CALL(Barrier(outside.comm));
-                DW_DBG(printf("#osp:dw(%i/%i): DISPLAYING\n",
-                              displayGroup.rank,displayGroup.size));
-          
-                displayCallback(recv_l,recv_r,objectForCallback);
-                // reset counter
-                numWrittenThisFrame = 0;
-                numExpectedThisFrame = wallConfig.displayPixelCount();
-                // and switch the in/out buffers
-                std::swap(recv_l,disp_l);
-                std::swap(recv_r,disp_r);
+              std::lock_guard<std::mutex> lock(frameMutex);
+              if (!unusedFrames.empty()) {
+                received = unusedFrames.back();
+                unusedFrames.pop_back();
               }
             }
+            if (!received)
+              received = new ReceivedFrame;
+            exchange.receive(received->tiles);
+            received->selfContained = true;
+            received->tiles.forEachTile([&](CompressedTile &encoded) {
+                const CodecType codec = encoded.getCodec();
+                if (codec == CODEC_UNCHANGED || codec == CODEC_DELTA)
+                  received->selfContained = false;
+              });
+            std::lock_guard<std::mutex> lock(frameMutex);
+            receivedFrames.push_back(received);
+            frameReceived.notify_one();
           }
-          CompressedTile::freeDecompressor(decompressor);
-#if THREADED_RECV
         });
+
+      /* each decode task has its own (stateful) decoders, and its
+         own decode target for tiles that are only partly visible on
+         this display */
+      std::vector<CodecSet *> codecs(numDecodeThreads);
+      for (auto &c : codecs)
+        c = new CodecSet;
+      std::vector<std::vector<uint32_t>> scratch(numDecodeThreads);
+      /* the current frame's tiles (data and size), in its batch */
+      std::vector<std::pair<unsigned char *,int>> tiles;
+      /* the last frame we published, which we keep, since the next
+         one's 'unchanged' and 'delta' tiles reference it */
+      Frame *prev = NULL;
+
+#ifdef OSPRAY_TASKING_TBB
+      tbb::task_scheduler_init tbb_init;
 #endif
+      cout << "#osp:dw: display " << displayGroup.rank << " receiving whole frames,"
+           << " and writing them with " << numDecodeThreads << " thread(s)" << endl;
+      for (int frameID=0;;frameID++) {
+        ReceivedFrame *received;
+        bool superseded;
+        {
+          std::unique_lock<std::mutex> lock(frameMutex);
+          frameReceived.wait(lock,[&]() { return !receivedFrames.empty(); });
+          received = receivedFrames.front();
+          receivedFrames.pop_front();
+          /* if the next frame is all here, too, and doesn't
+             reference this one, this one would never get shown: drop
+             it, without decoding any of its tiles */
+          superseded = !receivedFrames.empty() && receivedFrames.front()->selfContained;
+        }
+
+        Frame *frame = NULL;
+        if (!superseded) {
+          frame = frameQueue->acquire();
+          frame->frameID = frameID;
+          tiles.clear();
+          received->tiles.forEachTile([&](CompressedTile &encoded) {
+              tiles.push_back(std::make_pair(encoded.data,encoded.numBytes));
+            });
+          std::atomic<size_t> nextTile(0);
+          tasking::parallel_for(numDecodeThreads,[&](int threadID) {
+              while (1) {
+                const size_t tileID = nextTile++;
+                if (tileID >= tiles.size())
+                  break;
+                CompressedTile encoded(tiles[tileID].first,tiles[tileID].second,-1);
+                const int eye = encoded.getEye();
+                assembleTile(encoded,*codecs[threadID],scratch[threadID],
+                             displayRegion,localPitch,
+                             eye ? frame->pixel_r : frame->pixel_l,
+                             prev ? (eye ? prev->pixel_r : prev->pixel_l) : NULL);
+              }
+            });
+        }
+        {
+          std::lock_guard<std::mutex> lock(frameMutex);
+          unusedFrames.push_back(received);
+        }
+
+        /* clients don't block on their end of this barrier (see
+           Client::endFrame()), so this has to be the non-blocking
+           kind, too. Some MPIs let all but the root out of such a
+           barrier early (see Client::progressFrame()), so we also
+           wait for all other displays */
+        MPI_Request frameDone = outside.ibarrier();
+        MPI_CALL(Wait(&frameDone,MPI_STATUS_IGNORE));
+        displayGroup.barrier();
+        if (!frame) {
+          frameQueue->countDropped();
+          continue;
+        }
+        frameQueue->publish(frame);
+        if (prev)
+          frameQueue->release(prev);
+        prev = frame;
+        displayCallback(frameQueue,objectForCallback);
+      }
+      receiveThread.join();
     }
 
   } // ::ospray::dw
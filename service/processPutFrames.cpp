@@ -0,0 +1,68 @@
+/* 
+Copyright (c) 2016 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "Server.h"
+#include "../common/FrameWindow.h"
+
+namespace ospray {
+  namespace dw {
+
+    /*! with putFrames, clients write their pixels straight into our
+        receive buffers, so there's nothing to receive or decode: all
+        we do is wait for each frame's barrier (which clients only
+        enter once their puts for that frame have completed), and
+        copy the frame out of the receive buffers, so clients can
+        re-use those for later frames while the presenter still
+        shows this one */
+    void Server::processPutFrames(MPI::Group &outside)
+    {
+      allocateFrameBuffers();
+      FrameWindow window(outside,true,wallConfig,maxFramesInFlight+1);
+      const size_t numEyePixels = wallConfig.pixelsPerDisplay.product();
+
+      for (int frameID=0;;frameID++) {
+        /* clients don't block on their end of this barrier (see
+           Client::endFrame()), so this has to be the non-blocking
+           kind, too. Some MPIs let all but the root out of such a
+           barrier early (see Client::progressFrame()), so we also
+           wait for our root */
+        MPI_Request frameDone = outside.ibarrier();
+        MPI_CALL(Wait(&frameDone,MPI_STATUS_IGNORE));
+        displayGroup.barrier();
+
+        /* clients can't put the frame that goes into this frame's
+           buffers before we've entered the next frame's barrier */
+        window.sync();
+        Frame *frame = frameQueue->acquire();
+        frame->frameID = frameID;
+        memcpy(frame->pixel_l,window.pixelsOf(frameID,0),numEyePixels*sizeof(uint32_t));
+        if (wallConfig.stereo)
+          memcpy(frame->pixel_r,window.pixelsOf(frameID,1),numEyePixels*sizeof(uint32_t));
+        frameQueue->publish(frame);
+        frameQueue->release(frame);
+        displayCallback(frameQueue,objectForCallback);
+      }
+    }
+
+  } // ::ospray::dw
+} // ::ospray
@@ -0,0 +1,187 @@
+/*
+Copyright (c) 2016-2017 Ingo Wald
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*! micro-benchmark for the pixel kernels: for every instruction set
+    the CPU supports, packs all tiles of a frame buffer into dense
+    tile buffers (and back), swizzles, and computes/applies inter-frame
+    residuals; reports throughput in GB/s of pixel data touched, and
+    checks every result against the scalar kernels */
+
+#include "common/PixelKernels.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <stdexcept>
+
+namespace ospray {
+  namespace dw {
+
+    using namespace ospcommon;
+
+    typedef std::chrono::high_resolution_clock Clock;
+
+    /*! all tiles of a frame buffer, with a dense buffer per tile */
+    struct TiledFrame {
+      TiledFrame(const vec2i &frameSize, int tileSize)
+        : frameSize(frameSize),
+          tileSize(tileSize),
+          numTiles((frameSize.x+tileSize-1)/tileSize,
+                   (frameSize.y+tileSize-1)/tileSize),
+          frame(frameSize.product()),
+          tiles(numTiles.product()*tileSize*tileSize)
+      {
+        for (size_t i=0;i<frame.size();i++)
+          frame[i] = uint32_t(i * 2654435761U);
+      }
+
+      /*! run 'kernel(tileBuffer,tileRegion)' for every tile */
+      template<typename Kernel>
+      void forEachTile(const Kernel &kernel)
+      {
+        for (int ty=0;ty<numTiles.y;ty++)
+          for (int tx=0;tx<numTiles.x;tx++) {
+            const vec2i lower = vec2i(tx,ty)*tileSize;
+            const vec2i upper(std::min(lower.x+tileSize,frameSize.x),
+                              std::min(lower.y+tileSize,frameSize.y));
+            const box2i region(lower,upper);
+            uint32_t *tile = tiles.data() + (ty*numTiles.x+tx)*tileSize*tileSize;
+            kernel(tile,region);
+          }
+      }
+
+      const vec2i frameSize;
+      const int   tileSize;
+      const vec2i numTiles;
+      std::vector<uint32_t> frame;
+      std::vector<uint32_t> tiles;
+    };
+
+    enum Op { PACK, UNPACK, SWIZZLE, SUBTRACT, ADD, NUM_OPS };
+    static const char *opNames[NUM_OPS] = { "pack", "unpack", "swizzle", "subtract", "add" };
+
+    /*! one pass of 'op' over the entire frame; tiles are read from
+        the frame (and the reference frame), results go to the tile
+        buffers (or back to the frame, for unpack) */
+    void runOp(const PixelKernels &k, Op op, TiledFrame &tf,
+               const std::vector<uint32_t> &reference)
+    {
+      const int pitch = tf.frameSize.x;
+      tf.forEachTile([&](uint32_t *tile, const box2i &region) {
+          const vec2i size = region.size();
+          const int ofs = region.lower.x + pitch * region.lower.y;
+          switch (op) {
+          case PACK:
+            k.copy(tile,size.x,tf.frame.data()+ofs,pitch,size);
+            break;
+          case UNPACK:
+            k.copy(tf.frame.data()+ofs,pitch,tile,size.x,size);
+            break;
+          case SWIZZLE:
+            k.swizzle(tile,size.x,tf.frame.data()+ofs,pitch,size);
+            break;
+          case SUBTRACT:
+            k.subtract(tile,size.x,tf.frame.data()+ofs,pitch,reference.data()+ofs,pitch,size);
+            break;
+          case ADD:
+            k.add(tile,size.x,reference.data()+ofs,pitch,tf.frame.data()+ofs,pitch,size);
+            break;
+          default:
+            break;
+          }
+        });
+    }
+
+    extern "C" int main(int ac, char **av)
+    {
+      vec2i frameSize(3840,2160);
+      std::vector<int> tileSizes = { 32, 64, 100, 128, 256 };
+      double minSeconds = .25;
+
+      for (int i=1;i<ac;i++) {
+        const std::string arg = av[i];
+        if (arg == "--frame-size" || arg == "-fs") {
+          frameSize.x = atoi(av[++i]);
+          frameSize.y = atoi(av[++i]);
+        } else if (arg == "--tile-size" || arg == "-ts") {
+          tileSizes = { atoi(av[++i]) };
+        } else if (arg == "--time" || arg == "-t") {
+          minSeconds = atof(av[++i]);
+        } else
+          throw std::runtime_error("unknown parameter '"+arg+"'");
+      }
+
+      const std::vector<const PixelKernels *> kernels = PixelKernels::allSupported();
+      printf("#osp:dw: pixel kernel benchmark, frame %ix%i, best isa '%s'\n",
+             frameSize.x,frameSize.y,PixelKernels::best().isa);
+
+      std::vector<uint32_t> reference(frameSize.product());
+      for (size_t i=0;i<reference.size();i++)
+        reference[i] = uint32_t(i * 40503U + 17);
+
+      for (int tileSize : tileSizes) {
+        printf("\ntile size %i\n%-10s",tileSize,"");
+        for (auto k : kernels) printf("%10s",k->isa);
+        printf("   (GB/s)\n");
+
+        for (int op=0;op<NUM_OPS;op++) {
+          // ground truth from the scalar kernels
+          TiledFrame expected(frameSize,tileSize);
+          if (op == UNPACK) runOp(*kernels[0],PACK,expected,reference);
+          runOp(*kernels[0],(Op)op,expected,reference);
+
+          printf("%-10s",opNames[op]);
+          for (auto k : kernels) {
+            TiledFrame tf(frameSize,tileSize);
+            if (op == UNPACK) runOp(*kernels[0],PACK,tf,reference);
+            // warm up, and check
+            runOp(*k,(Op)op,tf,reference);
+            if (tf.tiles != expected.tiles || tf.frame != expected.frame)
+              throw std::runtime_error(std::string("kernel mismatch for isa '")+k->isa
+                                       +"', op '"+opNames[op]+"'");
+
+            size_t numRuns = 0;
+            const auto begin = Clock::now();
+            double seconds = 0.;
+            while (seconds < minSeconds) {
+              runOp(*k,(Op)op,tf,reference);
+              ++numRuns;
+              seconds = std::chrono::duration<double>(Clock::now()-begin).count();
+            }
+            // bytes read plus bytes written per pass
+            const int numInputs = (op == SUBTRACT || op == ADD) ? 2 : 1;
+            const double bytes = double(numRuns) * frameSize.product()
+              * sizeof(uint32_t) * (numInputs+1);
+            printf("%10.2f",bytes/seconds*1e-9);
+            fflush(stdout);
+          }
+          printf("\n");
+        }
+      }
+      return 0;
+    }
+
+  } // ::ospray::dw
+} // ::ospray